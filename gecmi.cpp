@@ -1,12 +1,17 @@
+#include <iostream>
 #include <fstream>
 #include <stdexcept>
 #include <system_error>
+#include <memory>  // unique_ptr
+
+#include <tbb/parallel_invoke.h>
 
 #include <boost/program_options.hpp>
-#include <boost/numeric/ublas/io.hpp>
 
 #include "cluster_reader.hpp"
+#include "binary_cover.hpp"
 #include "bimap_cluster_populator.hpp"
+#include "deep_complete_simulator.hpp"
 #include "calculate_till_tolerance.hpp"
 
 using std::string;
@@ -17,10 +22,15 @@ using std::to_string;
 using std::invalid_argument;
 using std::domain_error;
 using std::system_error;
+using std::unique_ptr;
 namespace po = boost::program_options;
 using namespace gecmi;
 
 
+// Exit status when the time limit is reached before any estimate is available
+constexpr int  EXIT_NOESTIMATE = 2;
+
+
 int main(int argc, char* argv[])
 {
     string  descrstr = string("Generalized Conventional Mutual Information (GenConvMI)\n"
@@ -29,7 +39,8 @@ int main(int argc, char* argv[])
         "https://github.com/eXascaleInfolab/GenConvNMI"
         "\n\nUsage:\t").append(argv[0]).append(" [options] <clusters1> <clusters2>\n"
         "clusters  - clusters file in the CNL format (https://github.com/eXascaleInfolab/PyCABeM/blob/master/formats/format.cnl),"
-        " where each line lists space separated ids of the cluster members\n"
+        " where each line lists space separated ids of the cluster members,"
+        " or in the binary cover format produced by the --save-binary option\n"
         "\nOptions");
 
     po::options_description desc(descrstr);
@@ -44,7 +55,8 @@ int main(int argc, char* argv[])
             po::value<string>(),
             "synchronize the node base omitting the non-matching nodes\n"
             "NOTE: The node base is either the first input file or '-' (automatic selection"
-            " of the input file having the least number of nodes)")
+            " of the input file having the least number of nodes). The explicitly specified"
+            " node base is applied on loading of the second file unless it is saved (-b).")
         ("id-remap,i", "remap ids allowing arbitrary input ids (non-contiguous ranges)"
             ", otherwise ids should form a solid range and start from 0 or 1")
         ("nmis,n", "output both NMI [max] and NMI_sqrt")
@@ -62,6 +74,29 @@ int main(int argc, char* argv[])
             "average expected membership of nodes in the clusters, > 0, typically >= 1")
         ("retain-dups,d", "retain duplicated clusters if any instead of filtering them out"
             " (not recommended)")
+        ("save-binary,b", "save the loaded input collections in the binary cover format"
+            " to <clusters>.gcb files, which are loaded much faster than CNL")
+        ("hybrid,y", "evaluate analytically the nodes having a single membership in both collections"
+            ", sampling only the overlapping nodes, which is much faster on mostly non-overlapping covers")
+        ("exact,x", "require the exact evaluation, which is applicable only to the hard partitions"
+            " (each node is a member of exactly one cluster) on the same node base"
+            " and is performed automatically for them")
+        ("seed",
+            po::value<uint64_t>(),
+            "seed of the pseudo random generator to reproduce the evaluation"
+            " (the same for any number of threads), random by default")
+        ("time-limit,t",
+            po::value<double>()->default_value(0),
+            "max time of the stochastic evaluation in seconds, 0 means unlimited."
+            " The current results are reported when the limit is reached,"
+            " the exit status is 2 if no estimate is available by then")
+        ("max-samples",
+            po::value<uint64_t>()->default_value(0),
+            "max number of samples of the stochastic evaluation, 0 means unlimited."
+            " The current results are reported when the limit is reached\n"
+            "NOTE: The current estimate is printed to stderr on SIGUSR1 and SIGINT"
+            " during the stochastic sampling without interrupting it, the repeated SIGINT"
+            " terminates the process.")
     ;
     po::variables_map vm;
     po::store( po::command_line_parser(argc, argv)
@@ -112,32 +147,86 @@ int main(int argc, char* argv[])
 			+ " should be positive");
 
     {
-        const bool remap = vm.count("id-remap");  // Remap ids
+        bool remap = vm.count("id-remap");  // Remap ids
         const bool fltdups = !vm.count("retain-dups");  // Filter out duplicated clusters
+        const bool savebin = vm.count("save-binary");  // Save the inputs in the binary cover format
+        // Note: the idmap is released on leaving this scope, i.e. before the sampling
         IdMap idmap;  // Mapping of ids to provide solid range starting from 0 if required
         size_t  nmods1 = 0;  // The number of UNIQUE clusters (modules) in the first collection
         size_t  nmods2 = 0;
 
+        unique_ptr<parsed_clusters>  pcs1, pcs2;
+        auto load1 = [&] {
 #ifdef DEBUG
-        fprintf(stderr, "Loading %s...\n", positionals[0].c_str());
+            fprintf(stderr, "Loading %s...\n", positionals[0].c_str());
 #endif  // DEBUG
-        b1lnum = read_clusters(
-            in1,
-            bcp1,
-            positionals[0].c_str(),
-            remap ? &idmap : nullptr,
-            membership, fltdups, &nmods1
-        );
-
+            pcs1.reset(new parsed_clusters(in1, positionals[0].c_str(), membership, fltdups, remap));
+        };
+        // Note: the binary cover should hold the whole collection, so the second collection
+        // is synchronized after the loading if it is saved
+        if(ndbase1 && !savebin) {
+            // Load the node base and then the second collection retaining only the base nodes
+            // (streaming synchronization), so the non-matching nodes are never stored
+            load1();
+            id_filter_t  ndbase;
+            pcs1->nodes(ndbase);
+#ifdef DEBUG
+            fprintf(stderr, "Loading %s synchronized to the node base (filter: %lu bytes)...\n"
+                , positionals[1].c_str(), ndbase.bytes());
+#endif  // DEBUG
+            pcs2.reset(new parsed_clusters(in2, positionals[1].c_str(), membership, fltdups, remap
+                , &ndbase));
+        } else {
+            // Load both collections concurrently
+            tbb::parallel_invoke(load1,
+                [&] {
 #ifdef DEBUG
-        fprintf(stderr, "Loading %s...\n", positionals[1].c_str());
+                    fprintf(stderr, "Loading %s...\n", positionals[1].c_str());
 #endif  // DEBUG
-        b2lnum = read_clusters(
-            in2,
-            bcp2,
-            positionals[1].c_str(),
-            remap ? &idmap : nullptr,
-            membership, fltdups, &nmods2
+                    pcs2.reset(new parsed_clusters(in2, positionals[1].c_str(), membership, fltdups, remap));
+                }
+            );
+        }
+        // Note: the vertex ids are used as indexes, so too sparse ids are remapped anyway
+        if(!remap) {
+            size_t  ids1end, mbs1num, ids2end, mbs2num;  // Upper bounds of the ids and the number of members
+            pcs1->ids_bounds(ids1end, mbs1num);
+            pcs2->ids_bounds(ids2end, mbs2num);
+            if(std::max(ids1end, ids2end) > 4 * std::max(mbs1num, mbs2num) + 1024) {
+                fprintf(stderr, "WARNING, the input ids are too sparse (up to %lu for %lu members)"
+                    " and are remapped, use -i to remap them explicitly\n"
+                    , std::max(ids1end, ids2end) - 1, std::max(mbs1num, mbs2num));
+                remap = true;
+            }
+        }
+        // Note: the shared idmap is built from the ids of both collections, the second collection
+        // is remapped concurrently with the population of the first one
+        if(remap) {
+            size_t  ids1end, mbs1num, ids2end, mbs2num;
+            pcs1->ids_bounds(ids1end, mbs1num);
+            pcs2->ids_bounds(ids2end, mbs2num);
+            vector<OrigId>  ids;
+            ids.reserve(mbs1num + mbs2num);
+            pcs1->member_ids(ids);
+            pcs2->member_ids(ids);
+            idmap.extend(move(ids));
+            pcs1->remap(idmap);
+        }
+        if(savebin && !pcs1->binary())
+            pcs1->save((positionals[0] + BINARY_COVER_EXT).c_str(), remap ? &idmap : nullptr);
+        tbb::parallel_invoke(
+            [&] {
+                b1lnum = pcs1->populate(bcp1, &nmods1);
+                pcs1.reset();
+            },
+            [&] {
+                if(remap)
+                    pcs2->remap(idmap);
+                if(savebin && !pcs2->binary())
+                    pcs2->save((positionals[1] + BINARY_COVER_EXT).c_str(), remap ? &idmap : nullptr);
+                b2lnum = pcs2->populate(bcp2, &nmods2);
+                pcs2.reset();
+            }
         );
 
         // Consider the case of single cluster collections, where NMI is not applicable
@@ -178,16 +267,29 @@ int main(int argc, char* argv[])
 
     const double risk = vm["risk" ].as<double>();
     const double epvar = vm["error"].as<double>();
+    const double timelim = vm["time-limit"].as<double>();
+    if(timelim < 0)
+        throw invalid_argument("time-limit = " + to_string(timelim) + " should be non-negative\n");
 
-    calculated_info_t cit = calculate_till_tolerance( two_rel, risk, epvar
-        , vm.count("fast"), b1lnum, b2lnum );
+    if(vm.count("seed"))
+        deep_complete_simulator::seed(vm["seed"].as<uint64_t>());
+    // Evaluate the hard partitions exactly, which is much faster than the stochastic evaluation
+    const bool  exact = hard_partitions( two_rel );
+    if(vm.count("exact") && !exact)
+        throw invalid_argument("The exact evaluation is applicable only to the hard partitions"
+            " (non-overlapping clusters) on the same node base\n");
+    calculated_info_t cit = exact ? calculate_exact( two_rel )
+        : calculate_till_tolerance( two_rel, risk, epvar, vm.count("fast"), b1lnum, b2lnum
+            , vm.count("hybrid"), timelim, vm["max-samples"].as<uint64_t>() );
+    if(!cit.available)
+        return EXIT_NOESTIMATE;
 
     if (vm.count("fnmi")) {
         const auto b1rnum = bcp1.uniqrSize();
         const auto b2rnum = bcp2.uniqrSize();
         printf("NMI_max: %G, FNMI: %G, NMI_sqrt: %G; cls1: %lu, cls2: %lu\n", cit.nmi
               // Note: 2^x is used instead of e^x to have the same base as in the log
-            , cit.nmi * pow(2, -abs(double(b1rnum - b2rnum)) / std::max(b1rnum, b2rnum))
+            , cit.nmi * pow(2, -std::abs(double(b1rnum) - double(b2rnum)) / std::max(b1rnum, b2rnum))
             , cit.nmi_sqrt, b1rnum, b2rnum);
     } else if (vm.count("nmis"))
         printf("NMI_max: %G, NMI_sqrt: %G\n", cit.nmi, cit.nmi_sqrt);
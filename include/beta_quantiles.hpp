@@ -0,0 +1,96 @@
+#ifndef GECMI__BETA_QUANTILES_HPP_
+#define GECMI__BETA_QUANTILES_HPP_
+
+#include <cstdint>
+#include <cmath>
+#include <vector>
+
+#include <boost/math/special_functions/beta.hpp>
+#include <boost/math/special_functions/erf.hpp>
+#include <tbb/parallel_for.h>
+
+
+namespace gecmi {
+
+    // Min parameters of the beta distribution to approximate its quantile
+    constexpr int64_t  BETA_APPROX_MIN = 1024;
+
+    // Quantiles of Beta(success + 1, total - success) at (1 - prob), which are equal to
+    // 1 - ibeta_inv(total - success, success + 1, prob), for the fixed total and prob.
+    // The quantiles having any parameter < BETA_APPROX_MIN are evaluated exactly and memoized,
+    // the remained ones are approximated by the Cornish-Fisher expansion with the skewness
+    // and kurtosis terms. The measured error is < 3E-5 of the standard deviation
+    // for prob E [1E-4, 0.99] and < 1E-5 of the deviation from the mean for
+    // prob E [1E-4, 0.3] U [0.7, 0.99], i.e. negligible for the variance.
+    class beta_quantiles {
+    public:
+        beta_quantiles( int64_t total, double prob ):
+            m_total( total ), m_prob( prob ),
+            m_z( std::sqrt( 2. ) * boost::math::erf_inv( 1 - 2 * prob ) ),  // Standard normal quantile at 1 - prob
+            m_zskew( (m_z * m_z - 1) / 6 ), m_zkurt( m_z * (m_z * m_z - 3) / 24 ),
+            m_zskew2( m_z * (2 * m_z * m_z - 5) / 36 ),
+            m_memo( 2 * BETA_APPROX_MIN, -1 ), m_required()
+        {}
+
+        // Mark the quantile as required, should be called for all successes before quantile()
+        void require( int64_t success )
+        {
+            const size_t  i = index( success );
+            if( i != NPOS && m_memo[i] < 0 ) {
+                m_memo[i] = 0;
+                m_required.push_back( success );
+            }
+        }
+
+        // Evaluate the required exact quantiles in parallel
+        void evaluate()
+        {
+            tbb::parallel_for( size_t(0), m_required.size(), [this]( size_t i ) {
+                const int64_t  success = m_required[i];
+                m_memo[index( success )] = success == m_total ? 1
+                    : 1 - boost::math::ibeta_inv( m_total - success, success + 1, m_prob );
+            });
+        }
+
+        double quantile( int64_t success ) const noexcept
+        {
+            const size_t  i = index( success );
+            if( i != NPOS )
+                return m_memo[i];
+            const double  a = success + 1;
+            const double  b = m_total - success;
+            const double  s = a + b;
+            const double  sig = std::sqrt( a * b / (s * s * (s + 1)) );  // Standard deviation
+            const double  skew = 2 * (b - a) * std::sqrt( s + 1 ) / ((s + 2) * std::sqrt( a * b ));
+            // Excess kurtosis
+            const double  kurt = 6 * ((a - b) * (a - b) * (s + 1) - a * b * (s + 2)) / (a * b * (s + 2) * (s + 3));
+            return a / s + sig * (m_z + skew * m_zskew + kurt * m_zkurt - skew * skew * m_zskew2);
+        }
+
+    private:
+        constexpr static size_t  NPOS = ~size_t(0);
+
+        // Index of the memoized quantile or NPOS if the quantile is approximated
+        size_t index( int64_t success ) const noexcept
+        {
+            if( success + 1 < BETA_APPROX_MIN )
+                return success;
+            if( m_total - success < BETA_APPROX_MIN )
+                return BETA_APPROX_MIN + m_total - success;
+            return NPOS;
+        }
+
+        const int64_t  m_total;
+        const double  m_prob;
+        const double  m_z;
+        // Cornish-Fisher polynomials of m_z for the skewness, kurtosis and squared skewness terms
+        const double  m_zskew;
+        const double  m_zkurt;
+        const double  m_zskew2;
+        std::vector<double>  m_memo;  // Exact quantiles, -1 if not required
+        std::vector<int64_t>  m_required;  // Successes of the required exact quantiles
+    };
+
+}  // gecmi
+
+#endif // GECMI__BETA_QUANTILES_HPP_
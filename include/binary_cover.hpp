@@ -0,0 +1,49 @@
+#ifndef GECMI__BINARY_COVER_HPP_
+#define GECMI__BINARY_COVER_HPP_
+
+#include <cstdint>
+#include <cstring>  // memcmp
+
+#include "cluster_reader.hpp"
+
+
+namespace gecmi {
+
+// Binary cover (clusters) format in the native byte order, which is memory-mapped
+// on loading without any parsing:
+//   binary_cover_header_t  header;
+//   uint64_t  ends[clsnum];  // End of the members of each cluster in the members array
+//   Id  members[mbsnum];  // Members of all clusters in the order of the clusters
+//   OrigId  origids[rmpnum];  // Original ids of the remapped members if any
+// The module id is the index of the cluster + 1, clusters might be empty to retain
+// the numbering of the source CNL file.
+constexpr char  BINARY_COVER_MAGIC[8] = {'G', 'E', 'C', 'M', 'I', 'C', 'V', 'R'};
+constexpr uint32_t  BINARY_COVER_VERSION = 1;
+// Default extension of the binary cover files
+constexpr const char*  BINARY_COVER_EXT = ".gcb";
+
+struct binary_cover_header_t {
+    enum flags_t: uint32_t {
+        UNIQUE = 1,  // Duplicated clusters are filtered out
+        REMAPPED = 2  // Members are remapped, origids are present
+    };
+
+    char  magic[8];  // BINARY_COVER_MAGIC
+    uint32_t  version;  // BINARY_COVER_VERSION
+    uint32_t  flags;  // Combination of flags_t
+    uint64_t  clsnum;  // The number of clusters including empty ones
+    uint64_t  mbsnum;  // The number of members (memberships)
+    uint64_t  ndsnum;  // The number of unique nodes
+    uint64_t  rmpnum;  // The number of original ids (size of the remapping table)
+};
+
+// Whether the content has the binary cover format
+inline bool is_binary_cover(const char* data, size_t size) noexcept
+{
+    return size >= sizeof(binary_cover_header_t)
+        && !memcmp(data, BINARY_COVER_MAGIC, sizeof BINARY_COVER_MAGIC);
+}
+
+}  // gecmi
+
+#endif // GECMI__BINARY_COVER_HPP_
@@ -1,6 +1,8 @@
 #ifndef GECMI__CALCULATE_TILL_TOLERANCE_HPP_
 #define GECMI__CALCULATE_TILL_TOLERANCE_HPP_
 
+#include <cstdint>
+
 #include "vertex_module_maps.hpp"
 
 
@@ -10,16 +12,31 @@ struct calculated_info_t {
     double empirical_variance;  // For NMI [max]
     double nmi;  // NMI_max
     double nmi_sqrt;
+    bool available = true;  // Whether the estimate is available (any samples are evaluated)
 };
 
+// Note: the current estimate is reported to stderr on SIGUSR1 and SIGINT while sampling
+// without interrupting the evaluation, the repeated SIGINT terminates the process as usual.
+// The estimate is not available if the time limit is reached before any sample is evaluated
 calculated_info_t calculate_till_tolerance(two_relations_ref two_rel,
     double risk, // <-- Upper bound of probability of the true value being
                   //  -- farthest from estimated value than the epvar
     double epvar,  // Max allowed variance of the result
     bool fasteval=false,  // Approximate (even less accurate), but much faster evaluation
-	size_t nds1num=0, size_t nds2num=0  // The number of nodes in the collections
+	size_t nds1num=0, size_t nds2num=0,  // The number of nodes in the collections
+    bool hybrid=false,  // Evaluate analytically the nodes having a single membership in both collections
+    double time_limit=0,  // Max evaluation time in seconds, 0 means unlimited
+    uint64_t max_samples=0  // Max number of the samples, 0 means unlimited
 );
 
+// Whether both collections are hard partitions (each node is a member of exactly
+// one cluster) on the same node base, which allows the exact evaluation
+bool hard_partitions(const two_relations_t& two_rel);
+
+// Exact evaluation of NMI for the hard partitions in a single parallel pass over the vertices,
+// the resulting variance is 0
+calculated_info_t calculate_exact(const two_relations_t& two_rel);
+
 } // gecmi
 
 #endif // GECMI__CALCULATE_TILL_TOLERANCE_HPP_
@@ -2,30 +2,124 @@
 #define CLUSTER_READER__CLUSTER_READER_HPP_
 
 #include <istream>
-#include <unordered_map>
+#include <vector>
+#include <cstdint>
 
 
 namespace gecmi {
 
-using std::unordered_map;
-
+typedef unsigned Id;  // Use unsigned to reduce the memory consumption on remapping
+typedef uint64_t OrigId;  // Original (input) id, which is narrowed to Id on remapping
 
 // Mapping of ids to provide solid range starting from 0 if required
-typedef unsigned Id;  // Use unsigned to reduce the memory consumption on remapping
-typedef unordered_map<Id, Id>  IdMap;
+// The internal id is the rank of the original id among the sorted unique ids of all
+// remapped inputs, it is looked up in the range of the bucket indexed by the high bits
+// of the id, which takes about 12 bytes per distinct id with a good locality
+class IdMap {
+    std::vector<OrigId>  ids;  // Sorted unique original ids
+    std::vector<Id>  buckets;  // Rank of the first id of each bucket
+    unsigned  shift;  // Bucket index of the id is (id >> shift)
+public:
+    IdMap(): ids(), buckets(), shift(0)  {}
+
+    // Extend the mapping with the ids (can contain duplicates), which are released
+    // Note: the internal ids are changed, so all inputs sharing the mapping
+    // should be added before any of them is remapped
+    void extend(std::vector<OrigId>&& nodes);
+
+    // Internal id of the original id or size() if the id is absent
+    Id operator()(OrigId id) const noexcept;
+
+    // The number of mapped ids
+    size_t size() const noexcept  { return ids.size(); }
+    bool empty() const noexcept  { return ids.empty(); }
+
+    // Original ids ordered by the internal ids
+    const std::vector<OrigId>& origids() const noexcept  { return ids; }
+
+    // Release the mapping
+    void clear() noexcept
+    {
+        std::vector<OrigId>().swap(ids);
+        std::vector<Id>().swap(buckets);
+        shift = 0;
+    }
+};
 
 // Input interface...
 class input_interface {
 public:
     virtual void add_vertex_module( size_t internal_vertex_id, size_t module_id ) = 0;
     virtual void reserve_vertices_modules( size_t vertices_num=0, size_t modules_num=0 ) = 0;
-    virtual void shrink_to_fit_modules() = 0;
+    virtual void finalize() = 0;  // Called once all modules are added
     virtual size_t uniqlSize() const=0;
     virtual size_t uniqrSize() const=0;
 public:
     virtual ~input_interface() = default;
 };
 
+// Membership filter of the node ids: a bitmap for the dense ids, otherwise sorted unique ids
+class id_filter_t {
+    std::vector<uint64_t>  bits;  // Bitmap of the ids
+    std::vector<OrigId>  ids;  // Sorted unique ids if the bitmap is not used
+public:
+    id_filter_t(): bits(), ids()  {}
+
+    // Build the filter from the ids (can contain duplicates), which are released
+    void build(std::vector<OrigId>&& nodes, OrigId ids_end);
+
+    // Whether the id is present
+    bool contains(OrigId id) const noexcept;
+
+    // The number of occupied bytes
+    size_t bytes() const noexcept
+        { return bits.size() * sizeof(uint64_t) + ids.size() * sizeof(OrigId); }
+};
+
+// Clusters parsed from the CNL input or loaded from the binary cover, which are remapped and populated separately
+// to allow concurrent loading of multiple inputs sharing the ids remapping
+class parsed_clusters {
+    struct pimpl_t;
+    pimpl_t* impl;
+public:
+    // Parse the input
+    parsed_clusters(std::istream& input, const char* fname=nullptr,
+        float membership=1.f,  // Average expected membership
+        bool fltdups=true,  // Filter out duplicates of clusters
+        bool remap=false,  // The ids are going to be remapped
+        const id_filter_t* filter=nullptr);  // Retain only the nodes passing the filter (streaming sync)
+    ~parsed_clusters();
+
+    // Forbid copying
+    parsed_clusters(parsed_clusters const&) = delete;
+    parsed_clusters& operator= (parsed_clusters const&) = delete;
+
+    // Whether the clusters are loaded from the binary cover
+    bool binary() const noexcept;
+
+    // Evaluate the upper bound of the member ids and the number of members
+    void ids_bounds(size_t& ids_end, size_t& members) const noexcept;
+
+    // Append the member ids (including repetitions) to ids
+    void member_ids(std::vector<OrigId>& ids) const;
+
+    // Build the filter of the nodes (original ids) to synchronize other inputs on their parsing
+    void nodes(id_filter_t& filter) const;
+
+    // Remap input ids to form a solid range using the (shared) idmap,
+    // which should be extended by the ids of all inputs beforehand
+    void remap(const IdMap& idmap);
+
+    // Save the clusters (filtering out duplicates if required) to the binary cover,
+    // idmap is specified if the ids were remapped
+    void save(const char* fname, const IdMap* idmap=nullptr);
+
+    // Populate the clusters releasing the parsed data, returns the number of nodes
+    // Note: the ids exceeding Id should be remapped beforehand
+    size_t populate(input_interface& inp_interf, size_t* nmods=nullptr);  // The number of unique clusters
+};
+
+// Note: the idmap is built from the input if it is empty, otherwise it should include all ids of the input
 size_t read_clusters(std::istream& input,
     input_interface& inp_interf, const char* fname=nullptr,
     IdMap* idmap=nullptr, float membership=1.f,  // Average expected membership
@@ -1,24 +1,159 @@
 #ifndef GECMI__CONFUSION_HPP_
 #define GECMI__CONFUSION_HPP_
 
-#include <boost/numeric/ublas/matrix_sparse.hpp>
-#include <boost/numeric/ublas/io.hpp>
-#include <boost/numeric/ublas/vector.hpp>
+#include <cstdint>
+#include <vector>
+#include <cassert>
 
 #include "bigfloat.hpp"
 
 
 namespace gecmi {
 
-    typedef boost::numeric::ublas::mapped_matrix< importance_float_t >
-        counter_matrix_t;
+    // Sparse contingency matrix accumulating the events:
+    // open addressing hash table (linear probing) keyed by the packed (row, col)
+    class counter_matrix_t {
+    public:
+        typedef uint64_t  key_t;  // (row << 32 | col)
 
-    typedef boost::numeric::ublas::mapped_matrix< importance_float_t >
-        importance_matrix_t;
+        constexpr static key_t  EMPTY_KEY = ~key_t(0);
 
-    typedef boost::numeric::ublas::vector< importance_float_t >
-        importance_vector_t;
+        // Note: the dimensions are used only for the indexing of the marginals,
+        // the storage grows with the number of the non-zero cells
+        counter_matrix_t( size_t rows=0, size_t cols=0 );
 
+        size_t size1() const noexcept  { return m_rows; }
+        size_t size2() const noexcept  { return m_cols; }
+
+        // The number of the non-zero cells
+        size_t nnz() const noexcept  { return m_used; }
+
+        static key_t key( size_t row, size_t col ) noexcept
+            { return key_t(row) << 32 | col; }
+
+        // Value of the (row, col) cell, which is inserted if absent
+        importance_float_t& at( size_t row, size_t col )
+        {
+            assert(row < UINT32_MAX && col < UINT32_MAX
+                && "at(), the indices are out of range");
+            if( (m_used + 1) * 2 > m_keys.size() )
+                grow();
+            const key_t  k = key( row, col );
+            size_t  i = slot( k );
+            while( m_keys[i] != k ) {
+                if( m_keys[i] == EMPTY_KEY ) {
+                    m_keys[i] = k;
+                    ++m_used;
+                    break;
+                }
+                i = (i + 1) & m_mask;
+            }
+            return m_vals[i];
+        }
+
+        // Accumulate the value in the (row, col) cell
+        void add( size_t row, size_t col, importance_float_t val )
+            { at( row, col ) += val; }
+
+        // Accumulate all cells of the matrix multiplied by the scale
+        void merge( const counter_matrix_t& cm, importance_float_t scale=1 );
+
+        // Value of the (row, col) cell
+        importance_float_t operator()( size_t row, size_t col ) const noexcept;
+
+        // The number of storage slots, which are visited by ranges on the parallel processing
+        size_t slots() const noexcept  { return m_keys.size(); }
+
+        // Visit the non-zero cells of the slots [begin, end) as f(row, col, value) in the storage order
+        template <typename F>
+        void for_each( F f, size_t begin, size_t end ) const
+        {
+            for( size_t i = begin; i < end; ++i )
+                if( m_keys[i] != EMPTY_KEY )
+                    f( size_t(m_keys[i] >> 32), size_t(m_keys[i] & UINT32_MAX), m_vals[i] );
+        }
+
+        // Visit all non-zero cells as f(row, col, value) in the storage order
+        template <typename F>
+        void for_each( F f ) const
+            { for_each( f, 0, m_keys.size() ); }
+
+        // Reset all cells retaining the allocated storage
+        void clear();
+
+    protected:
+        size_t slot( key_t k ) const noexcept
+            { return (k * 0x9E3779B97F4A7C15ull) >> m_shift; }  // Fibonacci hashing
+
+        // Double the capacity rehashing the cells
+        void grow();
+
+    private:
+        size_t  m_rows;
+        size_t  m_cols;
+        std::vector<key_t>  m_keys;
+        std::vector<importance_float_t>  m_vals;
+        size_t  m_used;  // The number of occupied slots
+        size_t  m_mask;  // Capacity - 1
+        unsigned  m_shift;  // 64 - log2(capacity)
+    };
+
+    // Compacted (normalized) contingency matrix:
+    // cells sorted by (row, col), i.e. the COO layout ordered as CSR,
+    // stored as the structure of arrays to be processed by the flat loops
+    struct importance_matrix_t {
+        size_t  rows;
+        size_t  cols;
+        std::vector<uint32_t>  row;  // Row of each cell
+        std::vector<uint32_t>  col;  // Column of each cell
+        std::vector<importance_float_t>  val;  // Value of each cell
+
+        importance_matrix_t(): rows(0), cols(0), row(), col(), val()  {}
+
+        size_t size1() const noexcept  { return rows; }
+        size_t size2() const noexcept  { return cols; }
+
+        // The number of the non-zero cells
+        size_t nnz() const noexcept  { return val.size(); }
+    };
+
+    typedef std::vector< importance_float_t >  importance_vector_t;
+
+    // Accumulated events (contingency matrix) with the marginals and the sums of x log2(x)
+    // of the cells and marginals, which are updated only for the changed cells on merging.
+    // So the entropies and the mutual information are evaluated in O(1) without
+    // the normalization of the whole matrix:
+    // H = log2(N) - sum(x log2(x)) / N,  MI = log2(N) + (sum_cells - sum_rows - sum_cols) / N
+    class events_accumulator_t {
+    public:
+        events_accumulator_t( size_t rows=0, size_t cols=0 );
+
+        // Accumulate the events multiplied by the scale
+        void merge( const counter_matrix_t& cm, importance_float_t scale=1 );
+
+        // Accumulated (unnormalized) events
+        const counter_matrix_t& cells() const noexcept  { return m_cells; }
+        const importance_vector_t& rows() const noexcept  { return m_rows; }
+        const importance_vector_t& cols() const noexcept  { return m_cols; }
+        importance_float_t total() const noexcept  { return m_total; }
+
+        // Entropy of the rows (first collection), columns and their mutual information
+        importance_float_t entropy_rows() const noexcept;
+        importance_float_t entropy_cols() const noexcept;
+        importance_float_t mutual_info() const noexcept;
+
+    private:
+        counter_matrix_t  m_cells;
+        importance_vector_t  m_rows;  // Row marginals
+        importance_vector_t  m_cols;  // Column marginals
+        importance_float_t  m_total;  // Total number of events
+        importance_float_t  m_cells_xlx;  // Sum of x log2(x) of the cells
+        importance_float_t  m_rows_xlx;  // Sum of x log2(x) of the row marginals
+        importance_float_t  m_cols_xlx;  // Sum of x log2(x) of the column marginals
+    };
+
+    // Compact the accumulated events into the normalized matrix sorted by (row, col)
+    // together with the row and column marginals
     void normalize_events( counter_matrix_t const& cm,
         importance_matrix_t& out_norm_conf,
         importance_vector_t& out_norm_cols,
@@ -43,22 +178,28 @@ namespace gecmi {
         importance_vector_t const& out_norm_rows
     );
 
+    // Evaluate exactly NMI_max and NMI_sqrt from the normalized events
+    void evaluate_nmi(
+        importance_matrix_t const& norm_conf,
+        importance_vector_t const& norm_cols,
+        importance_vector_t const& norm_rows,
+        double & out_nmi,  //  NMI max
+        double & out_nmi_sqrt
+    );
+
     importance_float_t total_events_from_unmi_cm(
         counter_matrix_t const& cm
     );
 
+    // Evaluate NMI and its max variance at the specified probability
     void variances_at_prob(
-        importance_matrix_t const& norm_conf,
-        importance_vector_t const& norm_cols,
-        importance_vector_t const& norm_rows,
-        int64_t total_events,
+        events_accumulator_t const& events,
         double prob,
         double & out_max_variance,
         double & out_nmi,  //  NMI max
         double & out_nmi_sqrt
     );
 
-    importance_matrix_t transpose(const importance_matrix_t& sm);
 }  // gecmi
 
 #endif // GECMI__CONFUSION_HPP_
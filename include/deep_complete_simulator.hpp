@@ -1,6 +1,8 @@
 #ifndef GECMI__DEEP_COMPLETE_SIMULATOR_HPP
 #define GECMI__DEEP_COMPLETE_SIMULATOR_HPP
 
+#include <cstdint>
+
 #include "vertex_module_maps.hpp"
 #include "bigfloat.hpp"
 
@@ -24,8 +26,15 @@ public:
     static void risk(double r);
     static double risk() noexcept;
 
+    // Base seed of the pseudo random generators of the forks (random by default)
+    static void seed(uint64_t s) noexcept;
+    static uint64_t seed() noexcept;
+
     // Required for initialization
-    deep_complete_simulator(two_relations_ref vmb, vertices_t& verts);
+    // verts  - origin vertices of the samples
+    // rverts  - origin vertices of the samples retried after the failed attempts, verts if omitted
+    deep_complete_simulator(two_relations_ref vmb, vertices_t& verts
+        , const std::vector<vmid_t>* rverts=nullptr);
 
     // Required for pimpl
     ~deep_complete_simulator();
@@ -41,9 +50,18 @@ public:
     // Deterministic fork...
     deep_complete_simulator fork() const;
 
+    // Reseed the generator for the specified absolute index of the sample,
+    // which makes the sample independent from the preceding ones
+    void reseed(uint64_t sample) noexcept;
+
     // Logic here: just get two numbers, a sample from the random
     // variable. The two numbers represent modules.
-    simulation_result_t get_sample() const;
+    // result  - resulting sample, which memory is reused between the calls
+    // reversed  - sample from the perspective of the second collection,
+    //  the resulting mods1 anyway belong to the first collection
+    // return  - false if the sample failed in the acceptable number of attempts
+    //  (the partition is not solvable), the result is empty in this case
+    bool get_sample(simulation_result_t& result, bool reversed=false) const;
 
     size_t vertices_num() const noexcept;
 };
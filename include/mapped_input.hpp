@@ -0,0 +1,33 @@
+#ifndef GECMI__MAPPED_INPUT_HPP_
+#define GECMI__MAPPED_INPUT_HPP_
+
+#include <istream>
+#include <vector>
+
+
+namespace gecmi {
+
+// Read-only content of the input file accessible as a contiguous memory range.
+// The file is memory-mapped when possible (zero copy), otherwise the input
+// stream is buffered in memory.
+class mapped_input {
+    const char*  addr;  // Beginning of the content
+    size_t  len;  // Content size in bytes
+    bool  mapped;  // The content is memory-mapped rather than buffered
+    std::vector<char>  buf;  // Buffered content if the mapping is not possible
+public:
+    mapped_input(std::istream& input, const char* fname=nullptr);
+    ~mapped_input();
+
+    // Forbid copying
+    mapped_input(mapped_input const&) = delete;
+    mapped_input& operator= (mapped_input const&) = delete;
+
+    const char* begin() const noexcept  { return addr; }
+    const char* end() const noexcept  { return addr + len; }
+    size_t size() const noexcept  { return len; }
+};
+
+}  // gecmi
+
+#endif // GECMI__MAPPED_INPUT_HPP_
@@ -0,0 +1,197 @@
+#ifndef GECMI__MODULE_SET_HPP_
+#define GECMI__MODULE_SET_HPP_
+
+#include <cstdint>
+#include <cstddef>
+#include <algorithm>  // copy, equal, max
+#include <utility>  // move, swap
+
+
+namespace gecmi {
+
+typedef uint32_t  vmid_t;  // Internal id of the vertices and modules
+
+// Sorted unique ids of the modules stored inline up to INLINE_CAPACITY items,
+// which covers the vast majority of the vertices (typically 0-4 modules),
+// and in the heap otherwise.
+// Note: the heap memory is retained on clear() and exchanged on the move assignment
+// to be reused, it is released only on destruction.
+class module_set_t {
+public:
+    constexpr static uint32_t  INLINE_CAPACITY = 8;
+
+    typedef vmid_t  value_type;
+    typedef const vmid_t*  const_iterator;
+    typedef const vmid_t*  iterator;  // The items are modified only via the members
+
+    module_set_t() noexcept: m_data(m_inline), m_size(0), m_capacity(INLINE_CAPACITY), m_inline()  {}
+
+    module_set_t(const module_set_t& other): module_set_t()
+        { assign(other.begin(), other.end()); }
+
+    module_set_t(module_set_t&& other) noexcept: module_set_t()
+        { *this = std::move(other); }
+
+    ~module_set_t()
+    {
+        if(m_data != m_inline)
+            delete[] m_data;
+    }
+
+    module_set_t& operator=(const module_set_t& other)
+    {
+        if(this != &other)
+            assign(other.begin(), other.end());
+        return *this;
+    }
+
+    module_set_t& operator=(module_set_t&& other) noexcept
+    {
+        if(this == &other)
+            return *this;
+        if(other.m_data != other.m_inline) {
+            // Steal the heap memory passing own heap memory if any to the source
+            const bool  heap = m_data != m_inline;
+            vmid_t* const  data = m_data;
+            const uint32_t  capacity = m_capacity;
+            m_data = other.m_data;
+            m_capacity = other.m_capacity;
+            other.m_data = heap ? data : other.m_inline;
+            other.m_capacity = heap ? capacity : INLINE_CAPACITY;
+        } else std::copy(other.m_inline, other.m_inline + other.m_size, m_data);
+        m_size = other.m_size;
+        other.m_size = 0;
+        return *this;
+    }
+
+    // Assign the sorted unique ids
+    template <typename Iter>
+    void assign(Iter first, Iter last)
+    {
+        const size_t  num = last - first;
+        reserve(num);
+        std::copy(first, last, m_data);
+        m_size = num;
+    }
+
+    // Append the id, which should be larger than the existing ones
+    void push_back(vmid_t id)
+    {
+        if(m_size == m_capacity)
+            reserve(m_capacity * 2);
+        m_data[m_size++] = id;
+    }
+
+    void clear() noexcept  { m_size = 0; }
+
+    // Exchange the content without any allocations
+    void swap(module_set_t& other) noexcept
+    {
+        if(m_data != m_inline && other.m_data != other.m_inline) {
+            std::swap(m_data, other.m_data);
+            std::swap(m_size, other.m_size);
+            std::swap(m_capacity, other.m_capacity);
+            return;
+        }
+        module_set_t  tmp(std::move(other));
+        other = std::move(*this);
+        *this = std::move(tmp);
+    }
+
+    size_t size() const noexcept  { return m_size; }
+    bool empty() const noexcept  { return !m_size; }
+
+    const vmid_t* data() const noexcept  { return m_data; }
+    const_iterator begin() const noexcept  { return m_data; }
+    const_iterator end() const noexcept  { return m_data + m_size; }
+    vmid_t operator[](size_t i) const noexcept  { return m_data[i]; }
+
+    bool operator==(const module_set_t& other) const noexcept
+        { return m_size == other.m_size && std::equal(begin(), end(), other.begin()); }
+    bool operator!=(const module_set_t& other) const noexcept
+        { return !(*this == other); }
+
+    // Ensure the capacity retaining the content
+    void reserve(size_t capacity)
+    {
+        if(capacity <= m_capacity)
+            return;
+        capacity = std::max<size_t>(capacity, m_capacity * 2);
+        vmid_t*  data = new vmid_t[capacity];
+        std::copy(m_data, m_data + m_size, data);
+        if(m_data != m_inline)
+            delete[] m_data;
+        m_data = data;
+        m_capacity = capacity;
+    }
+private:
+    vmid_t*  m_data;
+    uint32_t  m_size;
+    uint32_t  m_capacity;
+    vmid_t  m_inline[INLINE_CAPACITY];
+};
+
+// Max size of the sets to be processed using the bitmask (all pairs comparison)
+constexpr size_t  BITMASK_SET_SIZE = 16;
+
+// Bitmask of the items of a present in b
+// Note: the inner loop has no branches to be vectorized
+inline uint64_t members_mask(const module_set_t& a, const module_set_t& b) noexcept
+{
+    uint64_t  mask = 0;
+    const vmid_t*  bd = b.data();
+    const size_t  bs = b.size();
+    for(size_t i = 0; i < a.size(); ++i) {
+        const vmid_t  id = a[i];
+        unsigned  found = 0;
+        for(size_t j = 0; j < bs; ++j)
+            found |= bd[j] == id;
+        mask |= uint64_t(found) << i;
+    }
+    return mask;
+}
+
+// Items of a that are present (or absent if !present) in b, a and b are sorted,
+// out should differ from a and b
+inline void filter_members(const module_set_t& a, const module_set_t& b
+    , module_set_t& out, bool present)
+{
+    out.clear();
+    if(a.size() <= BITMASK_SET_SIZE && b.size() <= BITMASK_SET_SIZE) {
+        // Fast path for the tiny sets
+        uint64_t  mask = members_mask(a, b);
+        if(!present)
+            mask = ~mask;
+        for(size_t i = 0; i < a.size(); ++i)
+            if(mask >> i & 1)
+                out.push_back(a[i]);
+        return;
+    }
+    // Merge of the sorted sets
+    out.reserve(a.size());
+    const vmid_t*  ib = b.begin();
+    for(auto id: a) {
+        while(ib != b.end() && *ib < id)
+            ++ib;
+        if((ib != b.end() && *ib == id) == present)
+            out.push_back(id);
+    }
+}
+
+// Intersection of the sorted sets
+inline void set_intersection(const module_set_t& a, const module_set_t& b, module_set_t& out)
+{
+    filter_members(a, b, out, true);
+}
+
+// Difference of the sorted sets: a \ b
+inline void set_difference(const module_set_t& a, const module_set_t& b, module_set_t& out)
+{
+    filter_members(a, b, out, false);
+}
+
+inline void swap(module_set_t& a, module_set_t& b) noexcept  { a.swap(b); }
+
+}  // gecmi
+
+#endif // GECMI__MODULE_SET_HPP_
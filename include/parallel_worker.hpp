@@ -1,10 +1,13 @@
 #ifndef GECMI__PARALLEL_WORKER_HPP_
 #define GECMI__PARALLEL_WORKER_HPP_
 
+#include <cstdint>
+#include <chrono>
+
 #include <tbb/blocked_range.h>
-#include <tbb/spin_mutex.h>
 
 #include "deep_complete_simulator.hpp"
+#include "confusion.hpp"
 
 
 namespace gecmi {
@@ -13,40 +16,66 @@ namespace gecmi {
 // the work, so fork them... (fork function in deep_complete_simulator
 // takes care of doing a deterministic reseed of the randm
 // number generator...)
-template<typename counter_matrix_ptr>
+// The worker is a reduction body accumulating the samples in own sparse counters
+// without any locking. Each sample is generated from its absolute index, so
+// with parallel_deterministic_reduce (fixed splitting and joining order)
+// the results are the same for any number of threads.
+// The unmatched and failed samples are counted by the body (joined like the counters)
+// to be reported once per run by the caller instead of writing to stderr from the workers.
+// The ranges started after the deadline are skipped (and counted) to bound the evaluation time.
 struct direct_worker {
+    typedef std::chrono::steady_clock  clock_t;
+
     deep_complete_simulator dcs_u;
-    counter_matrix_ptr const  counter_mat_p;
-    tbb::spin_mutex* wait_for_matrix;
+    counter_matrix_t  counters;  // Accumulated samples
+    simulation_result_t  sr;  // Current sample, which memory is reused
+    const uint64_t  offset;  // Absolute index of the first sample in the range
+    const bool  reversed;  // Sample from the perspective of the second collection
+    size_t  unmatched;  // The number of unmatched samples (not solvable), including the failed ones
+    size_t  failed;  // The number of samples failed in the acceptable number of attempts
+    const clock_t::time_point  deadline;  // The ranges are not sampled after the deadline
+    size_t  skipped;  // The number of samples skipped because of the deadline
 
-    direct_worker( deep_complete_simulator& dcs, counter_matrix_ptr cmp, tbb::spin_mutex* wfm ):
+    direct_worker( deep_complete_simulator& dcs, uint64_t offs, bool rev=false
+        , clock_t::time_point dline=clock_t::time_point::max() ):
         dcs_u( dcs.fork() ),
-        counter_mat_p( cmp ),
-        wait_for_matrix( wfm )
+        counters( ),
+        sr( ),
+        offset( offs ),
+        reversed( rev ),
+        unmatched( 0 ),
+        failed( 0 ),
+        deadline( dline ),
+        skipped( 0 )
     {}
 
-    direct_worker( direct_worker const& other):
+    direct_worker( direct_worker& other, tbb::split ):
         dcs_u( other.dcs_u.fork() ),
-        counter_mat_p( other.counter_mat_p ),
-        wait_for_matrix( other.wait_for_matrix )
+        counters( ),
+        sr( ),
+        offset( other.offset ),
+        reversed( other.reversed ),
+        unmatched( 0 ),
+        failed( 0 ),
+        deadline( other.deadline ),
+        skipped( 0 )
     {}
 
     direct_worker& operator=(const direct_worker& other) = delete;
-//    {
-//        dcs_u = other.dcs_u.fork();
-//        counter_mat_p = other.counter_mat_p;
-//        wait_for_matrix = other.wait_for_matrix;
-//    }
 
-    void operator()( const tbb::blocked_range<size_t>& r ) const
+    void operator()( const tbb::blocked_range<size_t>& r )
     {
-        size_t  unmatched = 0;  // The number of unmatched clusters (not solvable)
+        if( deadline != clock_t::time_point::max() && clock_t::now() >= deadline ) {
+            skipped += r.size();
+            return;
+        }
         for( size_t i=r.begin(); i != r.end(); ++i )
         {
             // Pure and safe memory access to (almost) unrelated
             // locations... (yet contigous, so cache might suffer...)
             //
-            simulation_result_t sr = dcs_u.get_sample();
+            dcs_u.reseed( offset + i );
+            failed += !dcs_u.get_sample(sr, reversed);
 
 #ifdef DEBUG
             assert(sr.importance >= 0 && "blocked_range(), the importance should be non-negative");
@@ -56,18 +85,18 @@ struct direct_worker {
                 continue;
             }
             const importance_float_t prob = sr.importance / (sr.mods1.size() * sr.mods2.size());
-            {
-                tbb::spin_mutex::scoped_lock l(*wait_for_matrix);
-                for(auto m1: sr.mods1)
-                    for(auto m2: sr.mods2)
-                        (*counter_mat_p)(m1, m2) += prob;
-            }
+            for(auto m1: sr.mods1)
+                for(auto m2: sr.mods2)
+                    counters.add(m1, m2, prob);
         }
+    }
 
-        // Notify about the unmatched clusters
-        if(unmatched >= 1)
-            fprintf(stderr, "WARNING direct_worker, %lu unmatched (not solvable) clusters met on the collections comparison"
-                " (a single cluster could be accounted multiple times)\n", unmatched);
+    void join( const direct_worker& rhs )
+    {
+        counters.merge( rhs.counters );
+        unmatched += rhs.unmatched;
+        failed += rhs.failed;
+        skipped += rhs.skipped;
     }
 };
 
@@ -23,35 +23,45 @@ struct pa_status_t {
 
 // Represents the state information of a single player
 // on the simulation process.
+// The automaton is a lightweight stack object operating on the external
+// (per-worker scratch) buffers, so it does not allocate memory in the steady state.
 class player_automaton {
-    struct pimpl_t;
-    pimpl_t *impl;
+    remaining_modules_set_t&  rms;  // Note: rms size is usually 0, rarely up to ~4 on the 50 K nodes net
+    module_set_t&  tmp;  // Scratch buffer for the set operations (can be shared between the automatons)
+    bool operation_is_intersect;
 public:
-    player_automaton(remaining_modules_set_t const& rset);
-    ~player_automaton();
+    // rset  - initial remaining modules
+    // rbuf  - buffer for the remaining modules
+    // tbuf  - scratch buffer
+    player_automaton(remaining_modules_set_t const& rset, remaining_modules_set_t& rbuf
+        , module_set_t& tbuf);
 
     player_automaton(player_automaton const& other) = delete;
 
-    player_automaton( player_automaton&& other);
-
     player_automaton& operator=(const player_automaton&) = delete;
 
     // Called when a player receives a set of modules to operate on.
     void take_set( module_set_t const& mset  );
 
     // Called to set a common operation
-    void set_operation_kind( bool intersect );
+    void set_operation_kind( bool intersect )  { operation_is_intersect = intersect; }
 
     // Called when a coin is tossed and the next operation is decided.
-    pa_status_t::t get_status() const;
+    pa_status_t::t get_status() const
+    {
+        if ( rms.size() >= 2 )
+            return pa_status_t::GOING;
 
-//    size_t get_a_module() const;
+        if ( rms.size() == 0 )
+            return pa_status_t::EMPTY_SET;
+
+        return pa_status_t::SUCCESS;
+    }
 
     // Get all remaining modules
-    const remaining_modules_set_t& get_modules() const;
+    const remaining_modules_set_t& get_modules() const  { return rms; }
 };
 
 }  // gecmi
 
 #endif // GECMI__PLAYER_AUTOMATON_HPP_
-
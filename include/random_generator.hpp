@@ -0,0 +1,75 @@
+#ifndef GECMI__RANDOM_GENERATOR_HPP_
+#define GECMI__RANDOM_GENERATOR_HPP_
+
+#include <cstdint>
+#include <limits>
+
+
+namespace gecmi {
+
+// SplitMix64 step, used to expand a single seed into the generator state
+inline uint64_t splitmix64(uint64_t& x) noexcept
+{
+    uint64_t z = (x += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+// Seed derived from the key and the counter (e.g., the index of the sample)
+// for the counter-based generation of the independent random streams
+inline uint64_t counter_seed(uint64_t key, uint64_t counter) noexcept
+{
+    uint64_t  x = splitmix64(key) + counter;
+    return splitmix64(x);
+}
+
+// Uniform index E [0, n) from the 32 random bits using the multiply-shift
+// reduction (Lemire), which avoids the division
+inline uint32_t reduce_range(uint32_t r, uint32_t n) noexcept
+{
+    return uint64_t(r) * n >> 32;
+}
+
+// xoshiro256** pseudo random generator (Blackman & Vigna),
+// satisfies UniformRandomBitGenerator to be used with the std distributions
+class xoshiro256ss {
+    uint64_t  s[4];
+
+    static uint64_t rotl(uint64_t x, int k) noexcept
+        { return (x << k) | (x >> (64 - k)); }
+public:
+    typedef uint64_t  result_type;
+
+    explicit xoshiro256ss(uint64_t seed=0) noexcept: s()
+        { this->seed(seed); }
+
+    void seed(uint64_t seed) noexcept
+    {
+        for(auto& v: s)
+            v = splitmix64(seed);
+    }
+
+    static constexpr result_type min() noexcept  { return 0; }
+    static constexpr result_type max() noexcept
+        { return std::numeric_limits<result_type>::max(); }
+
+    result_type operator()() noexcept
+    {
+        const uint64_t  res = rotl(s[1] * 5, 7) * 9;
+        const uint64_t  t = s[1] << 17;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl(s[3], 45);
+
+        return res;
+    }
+};
+
+}  // gecmi
+
+#endif // GECMI__RANDOM_GENERATOR_HPP_
@@ -17,15 +17,13 @@ using std::ostream;
 // Extract the modules for the given vertex.
 void get_modules(
 	size_t vertex,
-	vertex_module_bimap_t const& vmb1,
-	vertex_module_bimap_t const& vmb2,
+	vertex_module_index_t const& vmi1,
+	vertex_module_index_t const& vmi2,
 	// out
 	module_set_t& out_mset1,
 	module_set_t& out_mset2
 	);
 
-//    static size_t get_vertex_count( vertex_module_bimap_t& vmb );
-
 inline ostream& operator<<( ostream& out, module_set_t const& mset )
 {
 	out << "(";
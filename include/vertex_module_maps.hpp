@@ -1,37 +1,106 @@
 #ifndef GECMI__VERTEX_MODULE_MAPS_HPP_
 #define GECMI__VERTEX_MODULE_MAPS_HPP_
 
-#include <set>
 #include <vector>
+#include <utility>  // pair
+#include <cstdint>
 
-#include <boost/bimap/unordered_multiset_of.hpp>
-#include <boost/bimap/bimap.hpp>
+#include "module_set.hpp"
 
 
 namespace gecmi {
 
-using namespace boost::bimaps;
+// Contiguous range of the ids in the index
+class ids_range_t {
+    const vmid_t*  first;
+    const vmid_t*  last;
+public:
+    ids_range_t(const vmid_t* first=nullptr, const vmid_t* last=nullptr) noexcept
+    : first(first), last(last)  {}
 
+    const vmid_t* begin() const noexcept  { return first; }
+    const vmid_t* end() const noexcept  { return last; }
+    size_t size() const noexcept  { return last - first; }
+    bool empty() const noexcept  { return first == last; }
+    vmid_t operator[](size_t i) const noexcept  { return first[i]; }
+};
+
+// Immutable bidirectional index of the vertices and modules in the CSR layout,
+// which is built once after the loading.
 // Normally vertices are assumed to be in the left, modules in the right.
+class vertex_module_index_t {
+    std::vector<size_t>  vmoffs;  // Offsets of the modules of each vertex in vmods, vertices range + 1 items
+    std::vector<vmid_t>  vmods;  // Modules of the vertices, unique and sorted for each vertex
+    std::vector<size_t>  mvoffs;  // Offsets of the member vertices of each module in mverts, modules range + 1 items
+    std::vector<vmid_t>  mverts;  // Member vertices of the modules in the input order
+    std::vector<vmid_t>  verts;  // Vertices having any modules, ascending
+    size_t  nmods;  // The number of non-empty modules
+
+    // Build the vertex to modules relations from the module to vertices relations
+    void build_vertices(size_t vertices_end);
+public:
+    typedef std::vector< std::pair<vmid_t, vmid_t> >  memberships_t;  // (vertex, module) pairs
+
+    vertex_module_index_t(): vmoffs(), vmods(), mvoffs(), mverts(), verts(), nmods(0)  {}
+
+    // Build the index from the memberships, which are released
+    void build(memberships_t&& mbs);
+
+    // Retain only the vertices present in the base index with their relations
+    void retain_vertices(const vertex_module_index_t& base);
+
+    // Modules of the vertex, unique and sorted
+    ids_range_t modules(size_t vertex) const noexcept
+    {
+        return vertex + 1 < vmoffs.size()
+            ? ids_range_t(vmods.data() + vmoffs[vertex], vmods.data() + vmoffs[vertex + 1])
+            : ids_range_t();
+    }
+
+    // Member vertices of the module
+    ids_range_t members(size_t module) const noexcept
+    {
+        return module + 1 < mvoffs.size()
+            ? ids_range_t(mverts.data() + mvoffs[module], mverts.data() + mvoffs[module + 1])
+            : ids_range_t();
+    }
+
+    // The number of memberships (vertex-module relations)
+    size_t size() const noexcept  { return mverts.size(); }
+
+    // Upper bound of the vertex ids
+    size_t vertices_end() const noexcept  { return vmoffs.empty() ? 0 : vmoffs.size() - 1; }
+
+    // Upper bound of the module ids
+    size_t modules_end() const noexcept  { return mvoffs.empty() ? 0 : mvoffs.size() - 1; }
+
+    // Vertices having any modules, ascending
+    const std::vector<vmid_t>& vertices() const noexcept  { return verts; }
+
+    // The number of vertices having any modules
+    size_t vertices_num() const noexcept  { return verts.size(); }
+
+    // The number of non-empty modules
+    size_t modules_num() const noexcept  { return nmods; }
+
+    // Whether each vertex is a member of at most one module (hard partition)
+    bool hard() const noexcept  { return vmods.size() == vertices_num(); }
+};
+
 // What happens if the network is swapped? There is a small chance that
 // some branches have to be discarded.
-typedef bimap< unordered_multiset_of<size_t>, unordered_multiset_of<size_t> >
-    vertex_module_bimap_t;  // Note: Vertex-module and Module-vertex bimaps have the same type
-
-typedef std::pair< vertex_module_bimap_t, vertex_module_bimap_t >
+typedef std::pair< vertex_module_index_t, vertex_module_index_t >
     two_relations_t;
 
 typedef two_relations_t&  two_relations_ref;
 
-typedef std::set< size_t > module_set_t;  // ATTENTIOM: must be an ORDERED container
-
+// Note: module_set_t is defined in module_set.hpp
 typedef module_set_t  modules_set_t;
 typedef module_set_t  remaining_modules_set_t;
 
 typedef std::vector< size_t >  vertices_t;
-typedef std::vector< size_t >  modules_t;
+typedef std::vector< vmid_t >  modules_t;
 
 }  // gecmi
 
 #endif // GECMI__VERTEX_MODULE_MAPS_HPP_
-
@@ -14,7 +14,7 @@
 
 #include <sstream>  // istringstream
 #include <string>
-#include <cstring>  // strtok
+#include <cstring>  // strtok, memchr
 #include <cmath>  // sqrt
 
 #ifdef __unix__
@@ -26,6 +26,60 @@ using std::string;
 using std::istream;
 using std::istringstream;
 
+//! \brief  Parse the header line of CNL file and validate the results
+//! \post clsnum <= ndsnum if ndsnum > 0. 0 means not specified
+//!
+//! \param line string&  - processing comment line, which is modified during the parsing
+//! \param[out] clsnum size_t&  - resulting number of clusters if specified, 0 in case of parsing errors
+//! \param[out] ndsnum size_t&  - resulting number of nodes if specified, 0 in case of parsing errors
+//! \return bool  - the line is the header
+bool parseHeaderLine(string& line, size_t& clsnum, size_t& ndsnum)
+{
+	// The target header is:  # Clusters: <cls_num>[,] Nodes: <cls_num>
+	const string  clsmark = "clusters";
+	const string  ndsmark = "nodes";
+
+	// 1. Replace the staring comment mark '#' with space to allow "#clusters:"
+	// 2. Replace ':' with space to allow "Clusters:<clsnum>"
+	for(size_t pos = 0; pos != string::npos; pos = line.find(':', pos + 1))
+		line[pos] = ' ';
+
+	istringstream fields(line);
+	string field;
+
+	// Read clusters specification
+	fields >> field;
+	if(field.length() != clsmark.length())
+		return false;
+	// Convert to lower case
+	for(size_t i = 0; i < field.length(); ++i)
+		field[i] = tolower(field[i]);
+	if(field != clsmark)
+		return false;
+	fields >> clsnum;
+
+	// Read nodes specification
+	fields >> field;
+	// Allow optional ','
+	if(!field.empty() && field[0] == ',')
+		fields >> field;
+	if(field.length() == ndsmark.length()) {
+		for(size_t i = 0; i < field.length(); ++i)
+			field[i] = tolower(field[i]);
+		if(field == ndsmark)
+			fields >> ndsnum;
+	}
+	// Validate and correct the number of clusters if required
+	// Note: it's better to reallocate a container a few times than too much overconsume the memory
+	if(ndsnum && clsnum > ndsnum) {
+		fprintf(stderr, "WARNING parseHeader(), clsnum (%lu) should not increase ndsnum (%lu)"
+			", fixed\n", clsnum, ndsnum);
+		clsnum = ndsnum;
+		//assert(0 && "parseHeader(), clsnum typically should be less than ndsnum");
+	}
+	return true;
+}
+
 //! \brief  Parse the header of CNL file and validate the results
 //! \post clsnum <= ndsnum if ndsnum > 0. 0 means not specified
 //!
@@ -37,9 +91,6 @@ using std::istringstream;
 void parseHeader(istream& fsm, string& line, size_t& clsnum, size_t& ndsnum)
 {
 	// Process the header, which is a special initial comment
-	// The target header is:  # Clusters: <cls_num>[,] Nodes: <cls_num>
-	const string  clsmark = "clusters";
-	const string  ndsmark = "nodes";
 	while(getline(fsm, line)) {
 		// Skip empty lines
 		if(line.empty())
@@ -47,51 +98,46 @@ void parseHeader(istream& fsm, string& line, size_t& clsnum, size_t& ndsnum)
 		// Consider only subsequent comments
 		if(line[0] != '#')
 			break;
-
-		// 1. Replace the staring comment mark '#' with space to allow "#clusters:"
-		// 2. Replace ':' with space to allow "Clusters:<clsnum>"
-		for(size_t pos = 0; pos != string::npos; pos = line.find(':', pos + 1))
-			line[pos] = ' ';
-
-		istringstream fields(line);
-		string field;
-
-		// Read clusters specification
-		fields >> field;
-		if(field.length() != clsmark.length())
+		if(!parseHeaderLine(line, clsnum, ndsnum))
 			continue;
-		// Convert to lower case
-		for(size_t i = 0; i < field.length(); ++i)
-			field[i] = tolower(field[i]);
-		if(field != clsmark)
-			continue;
-		fields >> clsnum;
-
-		// Read nodes specification
-		fields >> field;
-		// Allow optional ','
-		if(!field.empty() && field[0] == ',')
-			fields >> field;
-		if(field.length() == ndsmark.length()) {
-			for(size_t i = 0; i < field.length(); ++i)
-				field[i] = tolower(field[i]);
-			if(field == ndsmark)
-				fields >> ndsnum;
-		}
-		// Validate and correct the number of clusters if required
-		// Note: it's better to reallocate a container a few times than too much overconsume the memory
-		if(ndsnum && clsnum > ndsnum) {
-			fprintf(stderr, "WARNING parseHeader(), clsnum (%lu) should not increase ndsnum (%lu)"
-				", fixed\n", clsnum, ndsnum);
-			clsnum = ndsnum;
-			//assert(0 && "parseHeader(), clsnum typically should be less than ndsnum");
-		}
 		// Get following line for the unified subsequent processing
 		getline(fsm, line);
 		break;
 	}
 }
 
+//! \brief  Parse the header of CNL file loaded into the memory and validate the results
+//! \post clsnum <= ndsnum if ndsnum > 0. 0 means not specified
+//!
+//! \param[in,out] pos const char*&  - beginning of the content, set to the first line following the header
+//! \param end const char*  - end of the content
+//! \param[out] clsnum size_t&  - resulting number of clusters if specified, 0 in case of parsing errors
+//! \param[out] ndsnum size_t&  - resulting number of nodes if specified, 0 in case of parsing errors
+//! \return void
+void parseHeader(const char*& pos, const char* end, size_t& clsnum, size_t& ndsnum)
+{
+	string  line;
+	// Process the header, which is a special initial comment
+	while(pos != end) {
+		const char*  eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+		if(!eol)
+			eol = end;
+		// Skip empty lines
+		if(pos == eol) {
+			++pos;
+			continue;
+		}
+		// Consider only subsequent comments
+		if(*pos != '#')
+			break;
+		line.assign(pos, eol);
+		// Move to the following line for the unified subsequent processing
+		pos = eol != end ? eol + 1 : end;
+		if(parseHeaderLine(line, clsnum, ndsnum))
+			break;
+	}
+}
+
 //! \brief Estimate zeroized values
 //!
 //! \param ndsnum size_t&  - the estimate number of nodes if 0, otherwise omit it
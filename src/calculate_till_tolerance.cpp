@@ -1,5 +1,14 @@
+#include <cmath>  // sqrt, log2
+#include <cstdio>
+#include <csignal>
+#include <vector>
+#include <atomic>
+#include <chrono>
+
+#include <unistd.h>  // write
+
 #include <tbb/task_scheduler_init.h> // <-- For controlling number of working threads
-#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
 #include "bimap_cluster_populator.hpp"
 #include "confusion.hpp"
@@ -16,11 +25,219 @@
 // optimal using vector instantiation and shuffling
 constexpr size_t  EVCOUNT_GRAIN = 1536;
 constexpr double  STEPS_BOOST_RATIO = (1 + sqrt(5)) / 2;  // Golden ratio, ~= 1.618034
+// Planned steps are increased by this margin to not undershoot the required variance by an extra round
+constexpr double  STEPS_PLAN_MARGIN = 1.1;
+// Bounds of the planned steps relative to the steps performed so far
+constexpr double  STEPS_GROWTH_MIN = 0.25;
+constexpr double  STEPS_GROWTH_MAX = 16;
+// Bounds of the fitted exponent of the variance decay, the expected one is -0.5
+constexpr double  VARIANCE_SLOPE_MIN = -1;
+constexpr double  VARIANCE_SLOPE_MAX = -0.25;
+// Max number of the predicted rounds
+constexpr size_t  ROUNDS_PREDICTION_MAX = 64;
+// Size of the formatted estimate reported on the signals
+constexpr size_t  ESTIMATE_SIZE = 256;
 
 namespace gecmi {
 
 using std::domain_error;
 using std::to_string;
+using std::vector;
+
+// Statistics of the samples of an iteration
+struct samples_stat_t {
+    size_t  samples;  // The number of samples
+    size_t  unmatched;  // The number of unmatched samples (not solvable), including the failed ones
+    size_t  failed;  // The number of samples failed in the acceptable number of attempts
+};
+
+// Planner of the steps required to reach the specified variance, which decays as
+// n^slope (~ 1 / sqrt(n)) with the number of steps n, the slope is fitted on the completed rounds
+class steps_planner {
+public:
+    steps_planner(): m_total(0), m_prevtotal(0), m_prevvar(0), m_slope(-0.5)  {}
+
+    // Register the completed round and plan the steps of the next round
+    // steps  - the number of steps of the completed round
+    // maxvar  - the resulting max variance
+    // epvar  - the required variance
+    // predvar  - the predicted max variance after the planned round
+    // return  - the planned number of steps
+    size_t plan(size_t steps, double maxvar, double epvar, double& predvar)
+    {
+        m_prevtotal = m_total;
+        m_total += steps;
+        if(m_prevtotal && m_prevvar > 0 && maxvar > 0) {
+            const double  slope = log(maxvar / m_prevvar) / log(double(m_total) / m_prevtotal);
+            // Note: the fluctuations of the variance are bounded
+            if(std::isfinite(slope))
+                m_slope = std::min(std::max(slope, VARIANCE_SLOPE_MIN), VARIANCE_SLOPE_MAX);
+        }
+        m_prevvar = maxvar;
+        const size_t  planned = next_steps(m_total, maxvar, epvar);
+        predvar = maxvar * pow(double(m_total + planned) / m_total, m_slope);
+        return planned;
+    }
+
+    // The number of rounds predicted by the fitted decay to reach epvar following the plan,
+    // including the planned round, 0 if nothing is planned yet
+    size_t rounds(double epvar) const
+    {
+        size_t  num = 0;
+        if(!m_total)
+            return num;
+        size_t  total = m_total;
+        double  var = m_prevvar;
+        // Note: the growth of the rounds is bounded, so the number of rounds is bounded as well
+        while(var > epvar && num < ROUNDS_PREDICTION_MAX) {
+            const size_t  steps = next_steps(total, var, epvar);
+            var *= pow(double(total + steps) / total, m_slope);
+            total += steps;
+            ++num;
+        }
+        return num;
+    }
+
+    // The fitted slope of the variance decay
+    double slope() const noexcept  { return m_slope; }
+
+private:
+    // The number of steps of the next round after total steps resulting in maxvar
+    size_t next_steps(size_t total, double maxvar, double epvar) const
+    {
+        // The total number of steps required to reach epvar
+        const double  required = total * pow(maxvar / epvar, -1 / m_slope) * STEPS_PLAN_MARGIN;
+        const size_t  planned = std::min(std::max(required - total, total * STEPS_GROWTH_MIN)
+            , total * STEPS_GROWTH_MAX);
+        return std::max<size_t>(planned, 1);
+    }
+
+    size_t  m_total;  // The total number of the performed steps
+    size_t  m_prevtotal;  // The total number of steps before the last round
+    double  m_prevvar;  // Max variance before the last round
+    double  m_slope;  // Exponent of the variance decay
+};
+
+// Report the unmatched samples once per run if any
+static void report_unmatched(const vector<samples_stat_t>& stats)
+{
+    samples_stat_t  total{0, 0, 0};
+    for(const auto& st: stats) {
+        total.samples += st.samples;
+        total.unmatched += st.unmatched;
+        total.failed += st.failed;
+    }
+    if(!total.unmatched)
+        return;
+    fprintf(stderr, "WARNING calculate_till_tolerance(), %lu unmatched (not solvable) samples of %lu"
+        " (a single cluster could be accounted multiple times), %lu failed samples%s"
+        ", unmatched rate per iteration:", total.unmatched, total.samples, total.failed
+        , total.failed ? " (the partition is not solvable, results are approximate)" : "");
+    for(const auto& st: stats)
+        fprintf(stderr, " %.3G%%", st.samples ? 100. * st.unmatched / st.samples : 0.);
+    fputc('\n', stderr);
+}
+
+// The current estimate reported on the signals, which is formatted in advance
+// because the signal handler can call only the async-signal-safe functions.
+// Note: the estimate is double buffered to not be modified while being reported
+static const char  ESTIMATE_NONE[] = "> calculate_till_tolerance(), the estimate is not available yet\n";
+static char  estimates[2][ESTIMATE_SIZE] = {};
+static std::atomic<unsigned>  estcur(0);  // Index of the published estimate
+
+// Publish the current estimate
+static void publish_estimate(size_t rounds, uint64_t samples, double nmi, double nmi_sqrt
+    , double max_var, double epvar)
+{
+    const unsigned  next = !estcur.load(std::memory_order_relaxed);
+    snprintf(estimates[next], ESTIMATE_SIZE, "> calculate_till_tolerance(), the current estimate after"
+        " %lu rounds (%lu samples): NMI_max: %G, NMI_sqrt: %G, max_var: %G (epvar: %G)\n"
+        , rounds, samples, nmi, nmi_sqrt, max_var, epvar);
+    estcur.store(next, std::memory_order_release);
+}
+
+// Signal handler writing the published estimate to stderr
+static void report_estimate(int)
+{
+    const char*  est = estimates[estcur.load(std::memory_order_acquire)];
+    size_t  len = 0;
+    while(est[len])
+        ++len;
+    const ssize_t  res = write(STDERR_FILENO, est, len);
+    (void)res;
+}
+
+// Reporter of the published estimate on SIGUSR1 and SIGINT without interrupting the sampling,
+// the previous dispositions of the signals are restored by restore() or on destruction
+class estimate_reporter {
+public:
+    estimate_reporter(): m_usr1(), m_int(), m_installed(true)
+    {
+        // Note: the estimate is reset before the handlers are installed
+        snprintf(estimates[0], ESTIMATE_SIZE, "%s", ESTIMATE_NONE);
+        estcur.store(0, std::memory_order_release);
+        struct sigaction  sa{};
+        sa.sa_handler = report_estimate;
+        sigemptyset(&sa.sa_mask);
+        sa.sa_flags = SA_RESTART;
+        sigaction(SIGUSR1, &sa, &m_usr1);
+        // The repeated SIGINT is handled by default, i.e. terminates the process
+        sa.sa_flags |= SA_RESETHAND;
+        sigaction(SIGINT, &sa, &m_int);
+    }
+
+    ~estimate_reporter()  { restore(); }
+
+    // Restore the previous dispositions of the signals
+    void restore()
+    {
+        if(!m_installed)
+            return;
+        sigaction(SIGINT, &m_int, nullptr);
+        sigaction(SIGUSR1, &m_usr1, nullptr);
+        m_installed = false;
+    }
+
+    estimate_reporter(const estimate_reporter&) = delete;
+    estimate_reporter& operator=(const estimate_reporter&) = delete;
+
+private:
+    struct sigaction  m_usr1;  // Previous disposition of SIGUSR1
+    struct sigaction  m_int;  // Previous disposition of SIGINT
+    bool  m_installed;  // The handlers are installed
+};
+
+// Reduction body counting the co-occurrences of the modules of the vertices
+// having a single membership in both collections
+struct exact_counter {
+    const two_relations_t&  tworel;
+    counter_matrix_t  counters;
+
+    exact_counter(const two_relations_t& two_rel)
+    : tworel(two_rel), counters()  {}
+
+    exact_counter(exact_counter& other, tbb::split)
+    : tworel(other.tworel), counters()  {}
+
+    exact_counter& operator=(const exact_counter&) = delete;
+
+    void operator()(const tbb::blocked_range<size_t>& r)
+    {
+        for(size_t v = r.begin(); v != r.end(); ++v) {
+            const auto  mods1 = tworel.first.modules(v);
+            if(mods1.size() != 1)
+                continue;
+            const auto  mods2 = tworel.second.modules(v);
+            if(mods2.size() == 1)
+                counters.add(mods1[0], mods2[0], 1);
+        }
+    }
+
+    void join(const exact_counter& rhs)
+    {
+        counters.merge(rhs.counters);
+    }
+};
 
 calculated_info_t calculate_till_tolerance(
     two_relations_ref two_rel,
@@ -28,36 +245,46 @@ calculated_info_t calculate_till_tolerance(
                   //  -- farthest from estimated value than the epvar
     double epvar,
     bool fasteval,  // Use more approximate, but faster evaluation
-    size_t nds1num, size_t nds2num  // The number of nodes in the collections (if specified, otherwise 0)
+    size_t nds1num, size_t nds2num,  // The number of nodes in the collections (if specified, otherwise 0)
+    bool hybrid,  // Evaluate analytically the vertices having a single membership in both collections
+    double time_limit,  // Max evaluation time in seconds, 0 means unlimited
+    uint64_t max_samples  // Max number of the samples, 0 means unlimited
     )
 {
     assert(risk > 0 && risk < 1 && epvar > 0 && epvar < 1 && "risk and epvar should E (0, 1)");
+    assert(time_limit >= 0 && "calculate_till_tolerance(), time_limit should be non-negative");
 
-    deep_complete_simulator::risk(risk);
+    // Note: the rounds are interrupted on the deadline, so the time limit is met up to the duration
+    // of a single range of samples. The time limit above ~30 years is considered unlimited
+    // to avoid overflow of the clock.
+    typedef direct_worker::clock_t  clock_t;
+    const clock_t::time_point  deadline = time_limit > 0 && time_limit < 1e9
+        ? clock_t::now() + std::chrono::duration_cast<clock_t::duration>(std::chrono::duration<double>(time_limit))
+        : clock_t::time_point::max();
 
-    importance_matrix_t norm_conf;
-    importance_vector_t norm_cols;
-    importance_vector_t norm_rows;
+    deep_complete_simulator::risk(risk);
 
-    // left: Nodes, right: Clusters
-    size_t rows = uniqSize(two_rel.first.right) + 1;
-    size_t cols = uniqSize(two_rel.second.right) + 1;
+    // Note: module ids are used as indexes
+    size_t rows = two_rel.first.modules_end();
+    size_t cols = two_rel.second.modules_end();
 
-    counter_matrix_t cm =
-        boost::numeric::ublas::zero_matrix< importance_float_t >( rows, cols );
+    events_accumulator_t  events( rows, cols );  // Accumulated events
 
     importance_float_t nmi = 0;  // NMI_max
     importance_float_t nmi_sqrt = 0;
     importance_float_t max_var = 1.0e10;
 
-    vertices_t  vertices;
+    vertices_t  vertices;  // Sampled vertices
+    size_t  nverts = 0;  // The number of the base vertices including the analytically evaluated ones
+    const vector<vmid_t>*  rverts = nullptr;  // Origins of the retried samples in the hybrid mode
+    counter_matrix_t  hardcm;  // Contribution of the analytically evaluated (hard) vertices
     {
-        const auto  verts1Size = nds1num ? nds1num : uniqSize( two_rel.first.left );
+        const auto  verts1Size = nds1num ? nds1num : two_rel.first.vertices_num();
 #ifdef DEBUG
-        assert((!nds1num || nds1num == uniqSize(two_rel.first.left))
+        assert((!nds1num || nds1num == two_rel.first.vertices_num())
             && "calculate_till_tolerance(), specified nodes number is invalid");
 #endif // DEBUG
-        const auto  verts2Size = nds2num ? nds2num : uniqSize( two_rel.second.left );
+        const auto  verts2Size = nds2num ? nds2num : two_rel.second.vertices_num();
         if(verts1Size != verts2Size)
             fprintf(stderr, "WARNING calculate_till_tolerance(), the number of nodes is different"
                 " in the comparing collections: %lu != %lu\n", verts1Size, verts2Size);
@@ -69,17 +296,49 @@ calculated_info_t calculate_till_tolerance(
         // or improve accuracy given the same time.
         const bool  basefirst = verts1Size <= verts2Size;  // Use first collection as vertices base
         vertices.reserve(basefirst ? verts1Size : verts2Size);
-        auto& vmap = basefirst ? two_rel.first.left : two_rel.second.left;  // First vmap
+        const auto&  vmi = basefirst ? two_rel.first : two_rel.second;  // First index
         // Fill the vertices
-        for(const auto& ind = vmap.begin(); ind != vmap.end();) {
-            vertices.push_back(ind->first);
-            const_cast<typename std::remove_reference_t<decltype(vmap)>::iterator&>(ind)
-                = vmap.equal_range(ind->first).second;
-        }
+        // Note: a sample started from the vertex having a single membership in both collections
+        // is deterministic: it yields the pair of the vertex modules with importance 1
+        const auto&  vmi2 = basefirst ? two_rel.second : two_rel.first;  // Second index
+        const auto&  bverts = vmi.vertices();  // Base vertices
+        nverts = bverts.size();
+        if(!hybrid)
+            vertices.assign(bverts.begin(), bverts.end());
+        else for(auto v: bverts)
+            if(vmi.modules(v).size() != 1 || vmi2.modules(v).size() != 1)
+                vertices.push_back(v);
         vertices.shrink_to_fit();  // Free unused memory
+        if(hybrid) {
+            // Note: the failed samples are retried from any base vertex as in the default mode,
+            // including the analytic ones, which retains the distribution of the samples
+            rverts = &bverts;
+            exact_counter  ecnt(two_rel);
+            parallel_deterministic_reduce(
+                tbb::blocked_range< size_t >( 0, vmi.vertices_end(), EVCOUNT_GRAIN * 64 ),
+                ecnt
+            );
+            hardcm = std::move(ecnt.counters);
+#ifdef DEBUG
+            fprintf(stderr, "> calculate_till_tolerance(), hybrid evaluation: %lu sampled of %lu vertices"
+                ", %lu analytic contingency cells\n", vertices.size(), nverts, hardcm.nnz());
+#endif  // DEBUG
+        }
     }
 
-    deep_complete_simulator dcs(two_rel, vertices);
+    // All vertices are evaluated analytically
+    if(vertices.empty() && nverts) {
+        counter_matrix_t  hcm( rows, cols );
+        hcm.merge( hardcm );
+        importance_matrix_t norm_conf;
+        importance_vector_t norm_cols;
+        importance_vector_t norm_rows;
+        normalize_events( hcm, norm_conf, norm_cols, norm_rows );
+        evaluate_nmi( norm_conf, norm_cols, norm_rows, nmi, nmi_sqrt );
+        return calculated_info_t{0, nmi, nmi_sqrt};
+    }
+
+    deep_complete_simulator dcs(two_rel, vertices, rverts);
 
     // Evaluate required accuracy:
     const double  acr = 2*risk/(risk + epvar)*epvar;
@@ -96,9 +355,9 @@ calculated_info_t calculate_till_tolerance(
     float  avgdeg = fasteval ? 0.825f : 1;  // Normalized average degree [0, 1], let it be 0.65 for 10K and decreasing on larger nets
     // Note: vertices relations (>= vertices) are counted for the steps, which is important
     // in case the collection is a flattened hierarchy with multiple memberships for the nodes ~= number of levels
-    const size_t  steps_base = std::max(fasteval ? std::max(vertices.size(), rows + cols) * 1.5f
+    const size_t  steps_base = std::max(fasteval ? std::max(nverts, rows + cols) * 1.5f
         // Take the min number of all relations, which is >> the number of vertices
-        : std::min(two_rel.first.left.size(), two_rel.second.left.size()),  1 / float(epvar * sqrt(risk)));
+        : std::min(two_rel.first.size(), two_rel.second.size()),  1 / float(epvar * sqrt(risk)));
     if(fasteval) {
         const float  degrt = log2(steps_base) - log2(32768);  // 2^15 = 32768
         if(degrt > 1 / avgdeg)  // ~ >= 60 K
@@ -118,6 +377,8 @@ calculated_info_t calculate_till_tolerance(
 
     // Use this to adjust number of threads
     tbb::task_scheduler_init tsi;
+    // The number of the generated samples, which is used to key the randomness of the subsequent samples
+    uint64_t  sampled = 0;
 
     // Evaluate once from each side
     double sratio  = double(rows) / cols;  // Step ratio
@@ -128,59 +389,143 @@ calculated_info_t calculate_till_tolerance(
     fprintf(stderr, "> calculate_till_tolerance(), rows/cols: %G,  steps1: %lu, steps2: %lu,  sr: %G\n", double(rows) / cols
         , steps - steps1, steps1, steps1 / double(steps - steps1));
     size_t  iterations = 0;
+    size_t  predrounds = 1;  // The number of rounds predicted after the first one by the planner
 #endif  // DEBUG
+    vector<samples_stat_t>  stats;  // Statistics of the samples per iteration
+    steps_planner  planner;  // Planner of the steps of the subsequent rounds
+    double  predvar = 0;  // Predicted max_var of the round
+    uint64_t  evaluated = 0;  // The number of the evaluated (not skipped) samples
+    const char*  budget = nullptr;  // The exhausted budget if any
+    // Note: the estimate is reported on the signals only while sampling
+    estimate_reporter  reporter;
     while( epvar < max_var )
     {
-        const size_t  steps1 = sratio / 2 * steps;
+        // Only the sampled vertices are walked, the analytic vertices contribute proportionally
+        size_t  ssteps = std::max<size_t>(double(steps) * vertices.size() / nverts, 1);
+        if(max_samples && ssteps > max_samples - sampled)
+            ssteps = max_samples - sampled;
+        const size_t  steps1 = sratio / 2 * ssteps;
         // For the number of steps randomly selected vertices fill the matrix of modules (clusters) correspondence
-        tbb::spin_mutex wait_for_matrix;
+        // Note: the deterministic reduction splits the ranges by the grain and joins the results
+        // in the fixed order, so the results do not depend on the number of threads
         try {
-            parallel_for(
-                tbb::blocked_range< size_t >( 0, steps - steps1, EVCOUNT_GRAIN ),  // EVCOUNT_THRESHOLD
-                direct_worker< counter_matrix_t* >( dcs, &cm, &wait_for_matrix )
+            direct_worker  dwork( dcs, sampled, false, deadline );
+            parallel_deterministic_reduce(
+                tbb::blocked_range< size_t >( 0, ssteps - steps1, EVCOUNT_GRAIN ),  // EVCOUNT_THRESHOLD
+                dwork
             );
-            swap(two_rel.first, two_rel.second);
-            cm = transpose(cm);
-            parallel_for(
+            sampled += ssteps - steps1;
+            // Sample the remained steps from the perspective of the second collection
+            direct_worker  rwork( dcs, sampled, true, deadline );
+            parallel_deterministic_reduce(
                 tbb::blocked_range< size_t >( 0, steps1, EVCOUNT_GRAIN ),  // EVCOUNT_THRESHOLD
-                direct_worker< counter_matrix_t* >( dcs, &cm, &wait_for_matrix )
+                rwork
             );
+            sampled += steps1;
+            // The samples skipped on the deadline are not accounted
+            const size_t  done = ssteps - dwork.skipped - rwork.skipped;
+            evaluated += done;
+            stats.push_back({done, dwork.unmatched + rwork.unmatched, dwork.failed + rwork.failed});
+            events.merge( dwork.counters );
+            events.merge( rwork.counters );
+            // Each analytic vertex is expected to be the first origin of done / vertices.size() samples
+            if(hybrid)
+                events.merge( hardcm, double(done) / vertices.size() );
         } catch (tbb::tbb_exception const& e) {
             throw domain_error("SystemIsSuspiciuslyFailingTooMuch ctt (maybe your partition is not solvable?)\n");
         }
 
-        importance_float_t total_events = total_events_from_unmi_cm( cm );
-        normalize_events(
-            cm,
-            norm_conf,
-            norm_cols,
-            norm_rows,
-            total_events
-            );
-
-        variances_at_prob(
-            norm_conf, norm_cols, norm_rows,
-            total_events,
-            risk,
-            max_var,
-            nmi, nmi_sqrt
-            );
+        // No estimate is available if the time limit is reached before any sample is evaluated
+        if(events.total() <= 0 && deadline != clock_t::time_point::max()) {
+            budget = "time limit";
+            break;
+        }
+        // Note: the entropies and mutual information are maintained by the accumulator incrementally
+        variances_at_prob( events, risk, max_var, nmi, nmi_sqrt );
+        publish_estimate( stats.size(), evaluated, nmi, nmi_sqrt, max_var, epvar );
 
-            steps *= STEPS_BOOST_RATIO;  // 1.618; 1.25f;  // Use more steps on fail
 #ifdef DEBUG
-        fprintf(stderr, "> calculate_till_tolerance(), iteration completed  with %lu events"
-            " and max_var: %G (epvar: %G), steps: %lu, nmi_max: %G, nmi_sqrt: %G\n"
-            , uint64_t(total_events), max_var, epvar, steps, nmi, nmi_sqrt);
         ++iterations;
+        fprintf(stderr, "> calculate_till_tolerance(), iteration %lu completed  with %lu events"
+            " and max_var: %G (predicted: %G, epvar: %G), steps: %lu, nmi_max: %G, nmi_sqrt: %G\n"
+            , iterations, uint64_t(events.total()), max_var, predvar, epvar, steps, nmi, nmi_sqrt);
+#endif  // DEBUG
+        if( max_var <= epvar )
+            break;
+        // Stop on the exhausted budget retaining the current estimate
+        if( deadline != clock_t::time_point::max() && clock_t::now() >= deadline ) {
+            budget = "time limit";
+            break;
+        }
+        if( max_samples && sampled >= max_samples ) {
+            budget = "max number of samples";
+            break;
+        }
+        // Request just enough steps to reach epvar instead of the fixed growth
+        steps = planner.plan( steps, max_var, epvar, predvar );
+#ifdef DEBUG
+        const size_t  rounds = planner.rounds( epvar );  // The predicted number of the remained rounds
+        if( iterations == 1 )
+            predrounds = iterations + rounds;
+        fprintf(stderr, "> calculate_till_tolerance(), planned steps: %lu (variance slope: %G)"
+            ", predicted remained rounds: %lu\n", steps, planner.slope(), rounds);
 #endif  // DEBUG
     }
 
+    reporter.restore();
+    report_unmatched(stats);
+    if(events.total() <= 0 && budget) {
+        fprintf(stderr, "WARNING calculate_till_tolerance(), the %s is reached after %lu rounds"
+            " before any sample is evaluated, no estimate is available\n", budget, stats.size());
+        return calculated_info_t{max_var, 0, 0, false};
+    }
+    if(budget)
+        fprintf(stderr, "WARNING calculate_till_tolerance(), the %s is reached after %lu rounds"
+            " (%lu samples), the results are approximate having max_var: %G > epvar: %G\n"
+            , budget, stats.size(), evaluated, max_var, epvar);
 #ifdef DEBUG
-    fprintf(stderr, "> calculate_till_tolerance(), completed after %lu iterations"
+    fprintf(stderr, "> calculate_till_tolerance(), completed after %lu iterations (predicted: %lu)"
         ", max_var: %G, nmi_max: %G, nmi_sqrt: %G\n"
-        , iterations, max_var, nmi, nmi_sqrt);
+        , iterations, predrounds, max_var, nmi, nmi_sqrt);
 #endif  // DEBUG
     return calculated_info_t{max_var, nmi, nmi_sqrt};
 }// calculate_till_tolerance
 
+bool hard_partitions(const two_relations_t& two_rel)
+{
+    const auto&  vmi1 = two_rel.first;
+    const auto&  vmi2 = two_rel.second;
+    // Note: the node base should be the same
+    return vmi1.hard() && vmi2.hard() && vmi1.vertices() == vmi2.vertices();
+}
+
+calculated_info_t calculate_exact(const two_relations_t& two_rel)
+{
+#ifdef DEBUG
+    assert(hard_partitions(two_rel) && "calculate_exact(), the hard partitions are expected");
+#endif // DEBUG
+    exact_counter  ecnt(two_rel);
+    parallel_deterministic_reduce(
+        tbb::blocked_range< size_t >( 0, std::min(two_rel.first.vertices_end()
+            , two_rel.second.vertices_end()), EVCOUNT_GRAIN * 64 ),
+        ecnt
+    );
+    counter_matrix_t  cm( two_rel.first.modules_end(), two_rel.second.modules_end() );
+    cm.merge( ecnt.counters );
+
+    importance_matrix_t norm_conf;
+    importance_vector_t norm_cols;
+    importance_vector_t norm_rows;
+    normalize_events( cm, norm_conf, norm_cols, norm_rows );
+
+    double  nmi = 0;  // NMI_max
+    double  nmi_sqrt = 0;
+    evaluate_nmi( norm_conf, norm_cols, norm_rows, nmi, nmi_sqrt );
+#ifdef DEBUG
+    fprintf(stderr, "> calculate_exact(), contingency cells: %lu, nmi_max: %G, nmi_sqrt: %G\n"
+        , cm.nnz(), nmi, nmi_sqrt);
+#endif  // DEBUG
+    return calculated_info_t{0, nmi, nmi_sqrt};
+}
+
 }  // gecmi
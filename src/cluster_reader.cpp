@@ -1,157 +1,745 @@
 #include <iostream>
+#include <fstream>
+#include <stdexcept>
+#include <system_error>
+#include <limits>
+#include <memory>  // unique_ptr
 
 #include <vector>
-#include <unordered_map>
+
+#include <tbb/parallel_for.h>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_sort.h>
+
 #include "cnl_header_reader.hpp"
 #include "cluster_reader.hpp"
+#include "mapped_input.hpp"
+#include "binary_cover.hpp"
 #include "vertex_module_maps.hpp"
 #include "agghash.hpp"
 
 
 namespace gecmi {
 
-using std::stoul;
 using std::vector;
-using std::unordered_map;
+using std::invalid_argument;
+using std::out_of_range;
+using std::range_error;
+using std::domain_error;
+using std::unique_ptr;
+
+// Input chunks are parsed in parallel, each chunk is at least this size in bytes
+// Note: large chunks amortize the bookkeeping, small inputs are parsed by a single chunk
+constexpr size_t  PARSE_CHUNK_SIZE = 8 << 20;  // 8 MB
 
-// Note: unordered_map<size_t>, where size_t is std::hash may cause omission of distinct clusters having the same hash
 using ClusterHash = daoc::AggHash<>;
-using ClusterHashes = vector<ClusterHash>;  // The same size_t (ClusterHash::hash) can be yielded for distinct ClusterHash
-// Note: unordered_map should have keys of size_t, but distinct AggHash
-// may have the same AggHash::hash() : size_t. ClusterHashes are used as
-// values to guarantee that all distinct clusters (AggHash) are present even
-// if distinct AggHash have the same AggHash::hash() : size_t.
-using ClustersHashes = unordered_map<ClusterHash::IdT, ClusterHashes>;
+using ClusterHashes = vector<ClusterHash>;
 
+// Open addressing table of the cluster fingerprints (ClusterHash::hash()) referring
+// the hashes of the unique clusters, which are compared only on the fingerprint match
+// Note: distinct AggHash may have the same AggHash::hash(), so the matching fingerprint
+// is not sufficient to omit the cluster
+class ClustersFingerprints {
+    struct Slot {
+        size_t  fp;  // Fingerprint of the cluster
+        const ClusterHash*  chash;  // Hash of the cluster, nullptr for the empty slot
+    };
+    vector<Slot>  slots;
+    unsigned  shift;  // 64 - log2(capacity)
+public:
+    // clsnum  - the max number of the added clusters
+    explicit ClustersFingerprints(size_t clsnum): slots(), shift(0)
+    {
+        // Note: the load factor is at most 0.5
+        size_t  capacity = 16;
+        while(capacity < clsnum * 2)
+            capacity *= 2;
+        shift = 64 - __builtin_ctzll(capacity);
+        slots.assign(capacity, {0, nullptr});
+    }
 
-// size_t read_clusters( istream& input, input_interface& ) {{{
-size_t read_clusters( istream& input, input_interface& inp_interf, const char* fname,
-	IdMap* idmap, float membership, bool fltdups, size_t* nmods)
+    // Add the hash of the cluster, which should outlive the table,
+    // returns false if the same cluster has been already added
+    bool add(const ClusterHash& chash)
+    {
+        const size_t  fp = chash.hash();
+        const size_t  mask = slots.size() - 1;
+        for(size_t i = (fp * 0x9E3779B97F4A7C15ull) >> shift;; i = (i + 1) & mask) {  // Fibonacci hashing
+            auto&  slot = slots[i];
+            if(!slot.chash) {
+                slot = {fp, &chash};
+                return true;
+            }
+            if(slot.fp == fp && *slot.chash == chash)
+                return false;
+        }
+    }
+};
+
+// Whether the char is a delimiter of the ids in the line
+// Note: '\r' is considered to handle the CRLF line endings
+static inline bool is_delim(char c) noexcept  { return c == ' ' || c == '\t' || c == '\r'; }
+
+// Skip the delimiters till the end of the line
+static inline const char* skip_delims(const char* pos, const char* eol) noexcept
+{
+    while(pos != eol && is_delim(*pos))
+        ++pos;
+    return pos;
+}
+
+// Skip the token till the delimiter or the end of the line
+static inline const char* skip_token(const char* pos, const char* eol) noexcept
+{
+    while(pos != eol && !is_delim(*pos))
+        ++pos;
+    return pos;
+}
+
+// Scan the unsigned decimal id in place
+// Returns the position following the id digits or nullptr if the token is not an id
+static inline const char* scan_id(const char* pos, const char* eol, OrigId& id) noexcept
+{
+    constexpr OrigId  idmax = std::numeric_limits<OrigId>::max();
+    const char* const  beg = pos;
+    id = 0;
+    for(unsigned d; pos != eol && (d = unsigned(*pos) - '0') <= 9; ++pos) {
+        if(id > (idmax - d) / 10)
+            return nullptr;  // Overflow
+        id = id * 10 + d;
+    }
+    return pos != beg ? pos : nullptr;
+}
+
+// Clusters parsed from a line-aligned chunk of the input
+// Note: the members are stored as Id unless any of them exceeds Id, then all members
+// of the chunk are stored as OrigId till the remapping
+struct ChunkClusters {
+    vector<Id>  members;  // Members of all clusters of the chunk in the input order
+    vector<OrigId>  wides;  // Members of the chunk if any of them exceeds Id, members are empty then
+    vector<uint64_t>  ends;  // End of the members of each cluster, the clusters having only the id are included
+    ClusterHashes  hashes;  // Hashes of the clusters if they are evaluated on parsing
+
+    ChunkClusters(): members(), wides(), ends(), hashes()  {}
+
+    // Whether the members are stored as OrigId
+    bool wide() const noexcept  { return !wides.empty(); }
+
+    // The number of members
+    size_t mbsnum() const noexcept  { return wide() ? wides.size() : members.size(); }
+
+    // Append the member
+    void add(OrigId id)
+    {
+        if(!wide()) {
+            if(id <= std::numeric_limits<Id>::max()) {
+                members.push_back(id);
+                return;
+            }
+            wides.assign(members.begin(), members.end());
+            vector<Id>().swap(members);
+        }
+        wides.push_back(id);
+    }
+};
+
+// Clusters in the CSR layout, viewing either the parsed chunk or the binary cover
+struct ClustersView {
+    const Id*  members;  // Members of all clusters, nullptr if they are wide
+    const OrigId*  wides;  // Wide members of all clusters if any
+    const uint64_t*  ends;  // End of the members of each cluster
+    size_t  size;  // The number of clusters
+
+    // The number of members
+    size_t mbsnum() const noexcept  { return size ? ends[size - 1] : 0; }
+
+    // Member by its index
+    OrigId member(size_t i) const noexcept  { return members ? members[i] : wides[i]; }
+};
+
+// IdMap implementation {{{
+void IdMap::extend(vector<OrigId>&& nodes)
+{
+    if(ids.empty())
+        ids = move(nodes);
+    else {
+        ids.insert(ids.end(), nodes.begin(), nodes.end());
+        vector<OrigId>().swap(nodes);
+    }
+    tbb::parallel_sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.shrink_to_fit();
+    if(ids.size() >= std::numeric_limits<Id>::max())
+        throw out_of_range("IdMap::extend(), too many distinct ids: " + std::to_string(ids.size()) + "\n");
+
+    // Take about one id per bucket
+    // Note: the max id is used instead of the ids end to not overflow
+    shift = 0;
+    const OrigId  idmax = ids.empty() ? 0 : ids.back();
+    while(shift < 63 && idmax >> shift > ids.size())
+        ++shift;
+    // Note: the bucket ranges are [buckets[b], buckets[b + 1])
+    buckets.assign((idmax >> shift) + 2, 0);
+    size_t  b = 0;  // Bucket index
+    for(size_t i = 0; i < ids.size(); ++i)
+        while(b <= ids[i] >> shift)
+            buckets[b++] = i;
+    while(b < buckets.size())
+        buckets[b++] = ids.size();
+}
+
+Id IdMap::operator()(OrigId id) const noexcept
+{
+    const size_t  b = id >> shift;
+    if(b + 1 >= buckets.size())
+        return ids.size();
+    const auto  ibeg = ids.begin() + buckets[b];
+    const auto  iend = ids.begin() + buckets[b + 1];
+    const auto  iid = std::lower_bound(ibeg, iend, id);
+    return iid != iend && *iid == id ? iid - ids.begin() : ids.size();
+} // }}}
+
+// id_filter_t implementation {{{
+void id_filter_t::build(vector<OrigId>&& nodes, OrigId ids_end)
+{
+    bits.clear();
+    ids.clear();
+    // Use the bitmap if it is not larger than the ids
+    if(ids_end / 8 <= nodes.size() * sizeof(OrigId)) {
+        bits.assign(ids_end / 64 + 1, 0);
+        for(auto id: nodes)
+            bits[id / 64] |= uint64_t(1) << id % 64;
+        vector<OrigId>().swap(nodes);
+        return;
+    }
+    ids = move(nodes);
+    tbb::parallel_sort(ids.begin(), ids.end());
+    ids.erase(std::unique(ids.begin(), ids.end()), ids.end());
+    ids.shrink_to_fit();
+}
+
+bool id_filter_t::contains(OrigId id) const noexcept
+{
+    if(!bits.empty())
+        return id / 64 < bits.size() && bits[id / 64] >> id % 64 & 1;
+    return std::binary_search(ids.begin(), ids.end(), id);
+} // }}}
+
+// Parse a line-aligned chunk of the input
+// origin is the beginning of the content, used to report the errors
+// hashing tells whether to evaluate hashes of the clusters
+// filter  - retain only the nodes passing the filter if specified,
+//  the hashes are evaluated for all nodes of the clusters
+// Note: the hashes are not evaluated for the chunk having ids exceeding Id,
+// they are evaluated on the remapped ids
+static void parse_chunk(const char* pos, const char* const end, const char* origin
+    , bool hashing, const id_filter_t* filter, ChunkClusters& chunk)
+{
+    ClusterHash  chash;
+    for(const char* eol; pos != end; pos = eol != end ? eol + 1 : end) {
+        eol = static_cast<const char*>(memchr(pos, '\n', end - pos));
+        if(!eol)
+            eol = end;
+        pos = skip_delims(pos, eol);
+
+        // Skip empty lines and comments
+        if(pos == eol || *pos == '#')
+            continue;
+        // Skip the cluster id if present
+        const char*  tend = skip_token(pos, eol);
+        if(tend[-1] == '>')
+            pos = skip_delims(tend, eol);
+        // Note: the cluster having only the id is retained to preserve the clusters numbering
+        while(pos != eol) {
+            OrigId  id;  // Allow input ids to have huge range
+            tend = scan_id(pos, eol, id);
+            if(!tend) {
+                const string  tok(pos, skip_token(pos, eol));
+                if(!tok.empty() && tok.find_first_not_of("0123456789") == string::npos)
+                    throw out_of_range("read_clusters(), the id is out of range: " + tok);
+                throw invalid_argument("read_clusters(), invalid id '" + tok + "' at the offset "
+                    + std::to_string(pos - origin));
+            }
+            if(hashing && id > std::numeric_limits<Id>::max()) {
+                hashing = false;
+                chunk.hashes = ClusterHashes();
+            }
+            // Note: this algorithm does not support fuzzy overlaps (nodes with defined shares),
+            // the share part is skipped if exists
+            pos = skip_delims(skip_token(tend, eol), eol);
+            if(hashing)
+                chash.add(id);
+            if(!filter || filter->contains(id))
+                chunk.add(id);
+        }
+        chunk.ends.push_back(chunk.mbsnum());
+        if(hashing) {
+            chunk.hashes.push_back(chash);
+            chash.clear();
+        }
+    }
+}
+
+
+struct parsed_clusters::pimpl_t {
+    vector<ChunkClusters>  chunks;  // Parsed clusters in the input order
+    unique_ptr<mapped_input>  binary;  // Binary cover content if it is viewed directly (not copied to the chunks)
+    size_t  clsnum;  // The number of clusters
+    size_t  ndsnum;  // The number of nodes
+    bool  estimated;  // Whether the number of nodes/clusters is estimated
+    float  membership;  // Average expected membership
+    bool  fltdups;  // Filter out duplicates of clusters
+    bool  unique;  // The clusters are known to be unique (duplicates are filtered out)
+    bool  hashing;  // Hashes of the clusters are evaluated on parsing
+    bool  filtered;  // The nodes are filtered on parsing (the clusters are synchronized)
+    size_t  ndupcls;  // The number of omitted duplicated clusters
+
+    pimpl_t(float membership, bool fltdups, bool remap, bool filtered)
+    : chunks(), binary(), clsnum(0), ndsnum(0), estimated(false), membership(membership)
+    // Note: remapped ids are hashed on populating since the remapping depends on all inputs,
+    // but the filtered clusters are hashed on parsing to detect duplicates of the original clusters
+    , fltdups(fltdups), unique(false), hashing(fltdups && (!remap || filtered)), filtered(filtered)
+    , ndupcls(0)  {}
+
+    // Header of the viewed binary cover
+    const binary_cover_header_t& binary_header() const
+    {
+        return *reinterpret_cast<const binary_cover_header_t*>(binary->begin());
+    }
+
+    // Views of the clusters in the input order
+    vector<ClustersView> views() const
+    {
+        vector<ClustersView>  cvs;
+        if(binary) {
+            const auto&  hdr = binary_header();
+            const auto  ends = reinterpret_cast<const uint64_t*>(&hdr + 1);
+            cvs.push_back({reinterpret_cast<const Id*>(ends + hdr.clsnum), nullptr, ends, hdr.clsnum});
+        } else for(const auto& chunk: chunks)
+            cvs.push_back({chunk.wide() ? nullptr : chunk.members.data(), chunk.wides.data()
+                , chunk.ends.data(), chunk.ends.size()});
+        return cvs;
+    }
+
+    // Ensure that the members fit Id, i.e. the wide ids are remapped
+    void require_narrow(const char* func) const
+    {
+        for(const auto& chunk: chunks)
+            if(chunk.wide())
+                throw range_error(string(func) + ", the input ids exceed "
+                    + std::to_string(std::numeric_limits<Id>::max()) + " and should be remapped\n");
+    }
+
+    void load_binary(unique_ptr<mapped_input>&& content);
+
+    void materialize();
+
+    void filter_dups();
+
+    void filter_nodes(const id_filter_t& filter);
+};
+
+// void parsed_clusters::pimpl_t::load_binary( content ) {{{
+void parsed_clusters::pimpl_t::load_binary(unique_ptr<mapped_input>&& content)
+{
+    const auto&  hdr = *reinterpret_cast<const binary_cover_header_t*>(content->begin());
+    if(hdr.version != BINARY_COVER_VERSION)
+        throw domain_error("load_binary(), unsupported version of the binary cover: "
+            + std::to_string(hdr.version) + "\n");
+    // Note: the sizes are validated by parts to not overflow on the corrupted headers
+    const size_t  maxitems = content->size() / sizeof(Id);
+    if(hdr.clsnum > maxitems || hdr.mbsnum > maxitems || hdr.rmpnum > maxitems
+    || sizeof hdr + (hdr.clsnum + hdr.rmpnum) * sizeof(uint64_t) + hdr.mbsnum * sizeof(Id)
+        != content->size())
+        throw domain_error("load_binary(), the binary cover is corrupted\n");
+    clsnum = hdr.clsnum;
+    ndsnum = hdr.ndsnum;
+    unique = hdr.flags & binary_cover_header_t::UNIQUE;
+    binary = move(content);
+    // Restore the original ids if the members were remapped
+    if(hdr.flags & binary_cover_header_t::REMAPPED) {
+        const auto  origids = reinterpret_cast<const char*>(views()[0].members + hdr.mbsnum);
+        const Id  rmpnum = hdr.rmpnum;
+        materialize();
+        auto&  chunk = chunks[0];
+        chunk.wides.resize(chunk.members.size());
+        OrigId  idmax = 0;
+        for(size_t i = 0; i < chunk.members.size(); ++i) {
+            const Id  id = chunk.members[i];
+            if(id >= rmpnum)
+                throw domain_error("load_binary(), the binary cover is corrupted, id "
+                    + std::to_string(id) + " is out of the remapping table\n");
+            OrigId  oid;
+            memcpy(&oid, origids + id * sizeof oid, sizeof oid);  // Note: the table might be unaligned
+            chunk.wides[i] = oid;
+            idmax = std::max(idmax, oid);
+        }
+        // Retain the members narrow if possible
+        if(idmax <= std::numeric_limits<Id>::max()) {
+            std::copy(chunk.wides.begin(), chunk.wides.end(), chunk.members.begin());
+            vector<OrigId>().swap(chunk.wides);
+        } else vector<Id>().swap(chunk.members);
+        binary.reset();
+    }
+} // }}}
+
+// Copy the viewed binary cover to the chunk, which can be modified
+void parsed_clusters::pimpl_t::materialize()
+{
+    if(!binary)
+        return;
+    const auto  cv = views()[0];
+    chunks.resize(1);
+    chunks[0].members.assign(cv.members, cv.members + cv.mbsnum());
+    chunks[0].ends.assign(cv.ends, cv.ends + cv.size);
+    hashing = false;
+    // Note: the content is retained if the caller uses it
+}
+
+// void parsed_clusters::pimpl_t::filter_dups() {{{
+void parsed_clusters::pimpl_t::filter_dups()
+{
+    if(!fltdups || unique)
+        return;
+    materialize();
+    binary.reset();
+
+	// Evaluate hashes of the clusters in parallel if they were not evaluated on parsing
+	size_t  nclusters = 0;  // The number of clusters
+	for(auto& chunk: chunks) {
+		nclusters += chunk.ends.size();
+		if(chunk.hashes.size() == chunk.ends.size())
+			continue;
+		if(chunk.wide())
+			require_narrow("filter_dups()");
+		chunk.hashes.resize(chunk.ends.size());
+		tbb::parallel_for(tbb::blocked_range<size_t>(0, chunk.ends.size(), 1024)
+		, [&chunk](const tbb::blocked_range<size_t>& r) {
+			size_t  ib = r.begin() ? chunk.ends[r.begin() - 1] : 0;  // Beginning of the cluster members
+			for(size_t ic = r.begin(); ic < r.end(); ib = chunk.ends[ic++]) {
+				auto&  chash = chunk.hashes[ic];
+				for(size_t i = ib; i < chunk.ends[ic]; ++i)
+					chash.add(chunk.members[i]);
+			}
+		});
+	}
+	// Note: the fingerprints refer the hashes, which are released after the compaction
+	ClustersFingerprints  cfps(nclusters);
+
+	// Compact the chunks in the input order to retain the sequential numbering of the clusters
+	for(auto& chunk: chunks) {
+		size_t  ib = 0;  // Beginning of the cluster members
+		size_t  nb = 0;  // Beginning of the retained cluster members
+		size_t  nc = 0;  // Index of the retained cluster
+		for(size_t ic = 0; ic < chunk.ends.size(); ib = chunk.ends[ic++]) {
+			const size_t  ie = chunk.ends[ic];  // End of the cluster members
+			// Retain empty clusters, they are not hashed
+			// Omit the cluster if such cluster has been already added
+			// Note: this decreases clusters ids retaining the solid range
+			if(ib != ie && !cfps.add(chunk.hashes[ic])) {
+				++ndupcls;
+				continue;
+			}
+			if(nb != ib)
+				std::copy(chunk.members.begin() + ib, chunk.members.begin() + ie
+					, chunk.members.begin() + nb);
+			nb += ie - ib;
+			chunk.ends[nc++] = nb;
+		}
+		chunk.members.resize(nb);
+		chunk.ends.resize(nc);
+	}
+	// Release the hashes
+	for(auto& chunk: chunks)
+		chunk.hashes = ClusterHashes();
+	unique = true;
+} // }}}
+
+// Retain only the nodes passing the filter in the loaded binary cover
+void parsed_clusters::pimpl_t::filter_nodes(const id_filter_t& filter)
 {
-    // Note: CNL [CSN] format only is supported
-	string  line;
-	size_t  clsnum = 0;  // The number of clusters
-	size_t  ndsnum = 0;  // The number of nodes
-	parseHeader(input, line, clsnum, ndsnum);
+    // Note: duplicates are filtered out before the synchronization like on parsing
+    filter_dups();
+    materialize();
+    binary.reset();
+    auto&  chunk = chunks[0];
+    // Note: the restored original ids might be wide
+    auto  retain = [&chunk, &filter](auto& members) {
+        size_t  ib = 0;  // Beginning of the cluster members
+        size_t  nb = 0;  // End of the retained members
+        for(auto& ie: chunk.ends) {
+            for(size_t i = ib; i < ie; ++i)
+                if(filter.contains(members[i]))
+                    members[nb++] = members[i];
+            ib = ie;
+            ie = nb;
+        }
+        members.resize(nb);
+    };
+    if(chunk.wide())
+        retain(chunk.wides);
+    else retain(chunk.members);
+}
 
-	const size_t  cmsbytes = ndsnum ? 0 : inputSize(input, fname);
-	const bool  estimated = !ndsnum || !clsnum
+parsed_clusters::parsed_clusters(istream& input, const char* fname,
+	float membership, bool fltdups, bool remap, const id_filter_t* filter)
+: impl(new pimpl_t(membership, fltdups, remap, filter != nullptr))
+{
+    // Note: CNL [CSN] and binary cover formats are supported
+	// Note: the content is scanned in place, without any per-line allocations
+	unique_ptr<mapped_input>  content(new mapped_input(input, fname));
+	if(is_binary_cover(content->begin(), content->size())) {
+		impl->load_binary(move(content));
+		if(filter)
+			impl->filter_nodes(*filter);
+		return;
+	}
+	const char*  pos = content->begin();
+	const char* const  end = content->end();
+	size_t&  clsnum = impl->clsnum;  // The number of clusters
+	size_t&  ndsnum = impl->ndsnum;  // The number of nodes
+	parseHeader(pos, end, clsnum, ndsnum);
+
+	const size_t  cmsbytes = ndsnum ? 0 : content->size();
+	impl->estimated = !ndsnum || !clsnum
 		? estimateSizes(ndsnum, clsnum, cmsbytes, membership) : false;  // Whether the number of nodes/clusters is estimated
 //#ifdef DEBUG
 //	fprintf(stderr, "> read_clusters(), %lu bytes"
 //		" => estimated %lu nodes, %lu clusters\n", cmsbytes, ndsnum, clsnum);
 //#endif // DEBUG
 
+	// Split the payload into the line-aligned chunks and parse them in parallel
+	vector<const char*>  bounds = {pos};  // Bounds of the chunks
+	const size_t  chunksnum = std::max<size_t>((end - pos) / PARSE_CHUNK_SIZE, 1);
+	for(size_t i = 1; i < chunksnum; ++i) {
+		const char*  cpos = bounds[0] + (end - bounds[0]) * i / chunksnum;
+		if(cpos <= bounds.back())
+			continue;
+		cpos = static_cast<const char*>(memchr(cpos, '\n', end - cpos));
+		if(!cpos)
+			break;
+		bounds.push_back(cpos + 1);
+	}
+	bounds.push_back(end);
+	auto&  chunks = impl->chunks;
+	chunks.resize(bounds.size() - 1);
+	const bool  hashing = impl->hashing;
+	const char* const  origin = content->begin();
+	tbb::parallel_for(size_t(0), chunks.size(), [&](size_t i) {
+		parse_chunk(bounds[i], bounds[i + 1], origin, hashing, filter, chunks[i]);
+	});
+}
+
+parsed_clusters::~parsed_clusters()
+{
+    if(impl) {
+        delete impl;
+        impl = nullptr;
+    }
+}
+
+bool parsed_clusters::binary() const noexcept
+{
+	return impl->binary != nullptr;
+}
+
+void parsed_clusters::ids_bounds(size_t& ids_end, size_t& members) const noexcept
+{
+	ids_end = 0;
+	members = 0;
+	for(const auto& cv: impl->views()) {
+		const size_t  mbsnum = cv.mbsnum();
+		members += mbsnum;
+		for(size_t i = 0; i < mbsnum; ++i)
+			ids_end = std::max<size_t>(ids_end, cv.member(i) + 1);
+	}
+}
+
+void parsed_clusters::member_ids(vector<OrigId>& ids) const
+{
+	for(const auto& cv: impl->views()) {
+		if(cv.members)
+			ids.insert(ids.end(), cv.members, cv.members + cv.mbsnum());
+		else ids.insert(ids.end(), cv.wides, cv.wides + cv.mbsnum());
+	}
+}
+
+void parsed_clusters::nodes(id_filter_t& filter) const
+{
+	size_t  ids_end, members;
+	ids_bounds(ids_end, members);
+	vector<OrigId>  ids;
+	ids.reserve(members);
+	member_ids(ids);
+	filter.build(move(ids), ids_end);
+}
+
+void parsed_clusters::remap(const IdMap& idmap)
+{
+	impl->materialize();
+	impl->binary.reset();
+	// Note: the hashes of the original ids are dropped, the remapped ids are hashed on populating
+	// except the filtered clusters, where the hashes represent the original clusters
+	if(impl->hashing && !impl->filtered) {
+		impl->hashing = false;
+		for(auto& chunk: impl->chunks)
+			chunk.hashes = ClusterHashes();
+	}
+	// Note: the chunks are remapped in parallel, the wide members are narrowed
+	auto&  chunks = impl->chunks;
+	tbb::parallel_for(size_t(0), chunks.size(), [&](size_t i) {
+		auto&  chunk = chunks[i];
+		if(chunk.wide())
+			chunk.members.resize(chunk.wides.size());
+		for(size_t j = 0; j < chunk.members.size(); ++j) {
+			const OrigId  id = chunk.wide() ? chunk.wides[j] : chunk.members[j];
+			const Id  uid = idmap(id);
+			if(uid == idmap.size())
+				throw domain_error("remap(), the id " + std::to_string(id)
+					+ " is absent in the ids mapping\n");
+			chunk.members[j] = uid;
+		}
+		vector<OrigId>().swap(chunk.wides);
+	});
+}
+
+// void parsed_clusters::save( fname, idmap ) {{{
+void parsed_clusters::save(const char* fname, const IdMap* idmap)
+{
+	impl->filter_dups();
+	impl->require_narrow("save()");
+	const auto  cvs = impl->views();
+
+	binary_cover_header_t  hdr;
+	memset(&hdr, 0, sizeof hdr);  // Note: zeroize the padding if any
+	memcpy(hdr.magic, BINARY_COVER_MAGIC, sizeof hdr.magic);
+	hdr.version = BINARY_COVER_VERSION;
+	if(impl->unique)
+		hdr.flags |= binary_cover_header_t::UNIQUE;
+	if(idmap) {
+		hdr.flags |= binary_cover_header_t::REMAPPED;
+		hdr.rmpnum = idmap->size();
+	}
+	// Evaluate the number of clusters, members and unique nodes
+	vector<bool>  nodes;  // Whether the node is a member of any cluster
+	for(const auto& cv: cvs) {
+		hdr.clsnum += cv.size;
+		const size_t  mbsnum = cv.mbsnum();
+		hdr.mbsnum += mbsnum;
+		for(size_t i = 0; i < mbsnum; ++i) {
+			const Id  id = cv.members[i];
+			if(id >= nodes.size())
+				nodes.resize(id + 1);
+			if(!nodes[id]) {
+				nodes[id] = true;
+				++hdr.ndsnum;
+			}
+		}
+	}
+
+	std::ofstream  fout(fname, std::ios::binary | std::ios::trunc);
+	if(!fout)
+		throw std::system_error(errno, std::system_category()
+			, string("save(), could not create the binary cover: ") + fname + "\n");
+	fout.write(reinterpret_cast<const char*>(&hdr), sizeof hdr);
+	// Ends of the clusters are shifted by the members of the preceding chunks
+	uint64_t  mbsbase = 0;
+	for(const auto& cv: cvs) {
+		for(size_t i = 0; i < cv.size; ++i) {
+			const uint64_t  end = mbsbase + cv.ends[i];
+			fout.write(reinterpret_cast<const char*>(&end), sizeof end);
+		}
+		if(cv.size)
+			mbsbase += cv.ends[cv.size - 1];
+	}
+	for(const auto& cv: cvs)
+		if(cv.size)
+			fout.write(reinterpret_cast<const char*>(cv.members), cv.ends[cv.size - 1] * sizeof(Id));
+	if(idmap)
+		fout.write(reinterpret_cast<const char*>(idmap->origids().data()), idmap->size() * sizeof(OrigId));
+	if(!fout.flush())
+		throw std::system_error(errno, std::system_category()
+			, string("save(), could not write the binary cover: ") + fname + "\n");
+} // }}}
+
+// size_t parsed_clusters::populate( input_interface&, size_t* ) {{{
+size_t parsed_clusters::populate(input_interface& inp_interf, size_t* nmods)
+{
+	impl->filter_dups();
+	// Note: the ids are used as indexes of the vertices
+	impl->require_narrow("populate()");
+
+	const size_t  clsnum = impl->clsnum;  // The number of clusters
+	const size_t  ndsnum = impl->ndsnum;  // The number of nodes
 	//fprintf(stderr, "> read_clusters(), %lu clusters, %lu nodes\n", clsnum, ndsnum);
 	if(clsnum || ndsnum) {
 		// Note: reserve more than ndsnum * membership in case membership is not specified and overlaps are present
-		const size_t  rsvsize = ndsnum * membership + clsnum;  // Note: bimap has the same size of both sides
+		const size_t  rsvsize = ndsnum * impl->membership + clsnum;  // Note: the index has the same size of both sides
 #ifdef DEBUG
 		fprintf(stderr, "> read_clusters(), preallocating"
-			" %lu (%lu, %lu) elements, estimated: %u\n", rsvsize, ndsnum, clsnum, estimated);
+			" %lu (%lu, %lu) elements, estimated: %u\n", rsvsize, ndsnum, clsnum, impl->estimated);
 #endif // DEBUG
         inp_interf.reserve_vertices_modules(rsvsize, rsvsize);
 	}
 
-	// Preallocate hashes for the clusters if required
-	ClustersHashes  cshs;
-	if(fltdups)
-		cshs.reserve(clsnum);
-
-	ClusterHash  chash;
-	vertices_t  cmbs;  // Cluster members
-	size_t ndupcls = 0;  // The number of omitted duplicated clusters
+	// Populate the clusters in the input order
     size_t iline = 0;  // Payload line index (internal id of the cluster)
     size_t members = 0;  // Evaluate the actual number of members (nodes including repetitions)
-	Id  uid = idmap ? idmap->size() : 0;   // Unique id
-    // Preallocate idmap initially
-    if(idmap && !idmap->size())
-		idmap->reserve(ndsnum / sqrt(clsnum));  // Consider overlaps to not over allocate
-    do {
-        char *tok = strtok(const_cast<char*>(line.data()), " \t");
-
-        // Skip comments
-        // Note: Boost bimap of multiset does not support .reserve(),
-        // but has rehash()
-        // so do not look for the header
-        if(!tok || tok[0] == '#')
-            continue;
-        ++iline;  // Start modules (clusters) id from 1
-        // Skip the cluster id if present
-        if(tok[strlen(tok) - 1] == '>') {
-            tok = strtok(nullptr, " \t");
-            // Skip empty clusters
-            if(!tok)
-                continue;
-        }
-        do {
-        	size_t  id = stoul(tok);  // Allow input ids to have huge range
-			// Remap input ids to form a solid range if required
-			if(idmap) {
-				auto res = idmap->emplace(id, uid);
-				if(res.second)
-					id = uid++;
-				else id = res.first->second;
-			}
-
-            // Note: this algorithm does not support fuzzy overlaps (nodes with defined shares),
-            // the share part is skipped if exists
-			if(fltdups) {
-				if(id > std::numeric_limits<ClusterHash::IdT>::max())
-					throw std::range_error("Id '" + std::to_string(id)
-						+ "' is too large to be used with the ClusterHash");
-				chash.add(id);
-				cmbs.push_back(id);
-			} else {
-				inp_interf.add_vertex_module(id, iline);
-				// Note: the number of nodes can't be evaluated here simply incrementing the value,
-				// because clusters might have overlaps, i.e. the nodes might have multiple membership
-				++members;
-			}
-        } while((tok = strtok(nullptr, " \t")));
-        // Retain the unique clusters in the duplicates filtering mode
-        if(fltdups) {
-			// Add the cluster if such cluster has not been added yet
-			const auto ch = chash.hash();
-			const auto ich = cshs.find(ch);
-			if(ich == cshs.end()
-			|| std::find(ich->second.begin(), ich->second.end(), chash) == ich->second.end()) {
-				for(auto id: cmbs)
-					inp_interf.add_vertex_module(id, iline);
-				++members += cmbs.size();
-				cshs[ch].push_back(chash);
-			} else {
-				++ndupcls;
-				--iline;  // Decrease clusters id to retain the solid range
-			}
-			chash.clear();
-			cmbs.clear();
+	for(const auto& cv: impl->views()) {
+		size_t  ib = 0;  // Beginning of the cluster members
+		for(size_t ic = 0; ic < cv.size; ib = cv.ends[ic++]) {
+			const size_t  ie = cv.ends[ic];  // End of the cluster members
+			++iline;  // Start modules (clusters) id from 1
+			for(size_t i = ib; i < ie; ++i)
+				inp_interf.add_vertex_module(cv.members[i], iline);
+			// Note: the number of nodes can't be evaluated here simply incrementing the value,
+			// because clusters might have overlaps, i.e. the nodes might have multiple membership
+			members += ie - ib;
 		}
-    } while(getline(input, line));  // Note: the line does not contain '\n' in the end, EOL is trimmed
+	}
+	// Release the populated clusters
+	impl->chunks = vector<ChunkClusters>();
+	impl->binary.reset();
 
-	// Rehash the nodes decreasing the allocated space and number of buckets
-	// for the faster iterating if required
-	inp_interf.shrink_to_fit_modules();
+	inp_interf.finalize();
 
-    const size_t  ansnum = inp_interf.uniqlSize();;  // Evaluate the actual number of nodes, resulting value
+    const size_t  ansnum = inp_interf.uniqlSize();  // Evaluate the actual number of nodes, resulting value
 #ifdef DEBUG
 	fprintf(stderr, "> read_clusters(), expected & actual"
 		" nodes: %lu -> %lu, clusters: %lu -> %lu; nodes membership: %G\n"
 		, ndsnum, ansnum, clsnum, iline, float(members) / ansnum);
 #endif // DEBUG
-	if(!estimated && ((clsnum && clsnum != iline) || (ndsnum && ndsnum != ansnum)))
+	// Note: the number of nodes of the filtered clusters is reduced
+	if(!impl->estimated && ((clsnum && clsnum != iline)
+	|| (ndsnum && ndsnum != ansnum && !impl->filtered)))
 		fprintf(stderr, "WARNING read_clusters(),"
 			" The specified number of nodes/clusters does not correspond to the actual one"
 			"  nodes: %lu -> %lu, clusters: %lu -> %lu\n"
 			, ndsnum, ansnum, clsnum, iline);
-	if(ndupcls)
+	if(impl->ndupcls)
 		fprintf(stderr, "WARNING read_clusters(), %lu duplicated clusters omitted"
-			" from the input file\n", ndupcls);
+			" from the input file\n", impl->ndupcls);
 	// Output the number of loaded UNIQUE modules
 	if(nmods)
 		*nmods = iline;
 
 	return ansnum;
+} // }}}
+
+// size_t read_clusters( istream& input, input_interface& ) {{{
+size_t read_clusters( istream& input, input_interface& inp_interf, const char* fname,
+	IdMap* idmap, float membership, bool fltdups, size_t* nmods)
+{
+	parsed_clusters  pcs(input, fname, membership, fltdups, idmap != nullptr);
+	if(idmap) {
+		if(idmap->empty()) {
+			vector<OrigId>  ids;
+			pcs.member_ids(ids);
+			idmap->extend(move(ids));
+		}
+		pcs.remap(*idmap);
+	}
+	return pcs.populate(inp_interf, nmods);
 } // Reader function }}}
 
 }  // gecmi
@@ -1,11 +1,16 @@
 #include <iostream>
 #include <limits>
 #include <type_traits>
+#include <algorithm>
+#include <functional>  // plus
+#include <cmath>
 //#include <cassert>
 
-#include <boost/numeric/ublas/vector.hpp>
-#include <boost/math/special_functions/beta.hpp>
+#include <tbb/blocked_range.h>
+#include <tbb/parallel_for.h>
+#include <tbb/parallel_reduce.h>
 
+#include "beta_quantiles.hpp"
 #include "confusion.hpp"
 
 using std::cout;
@@ -16,6 +21,118 @@ namespace gecmi {
 
     constexpr static importance_float_t  eps = std::numeric_limits<importance_float_t>::epsilon();
 
+    // Initial capacity of the contingency hash table, power of 2
+    constexpr static size_t  COUNTERS_CAPACITY_MIN = 1024;
+
+    // The number of the contingency slots processed by a task on the parallel evaluation of the variance
+    constexpr static size_t  VARIANCE_GRAIN = 4096;
+
+    // The number of items processed by a task on the parallel reductions of the entropy and MI
+    constexpr static size_t  REDUCTION_GRAIN = 16384;
+
+    // The number of rows processed by a task on the normalization of the events
+    constexpr static size_t  MARGINALS_GRAIN = 4096;
+
+    // counter_matrix_t implementation {{{
+    constexpr counter_matrix_t::key_t  counter_matrix_t::EMPTY_KEY;
+
+    counter_matrix_t::counter_matrix_t( size_t rows, size_t cols ):
+        m_rows( rows ), m_cols( cols ),
+        m_keys( COUNTERS_CAPACITY_MIN, EMPTY_KEY ),
+        m_vals( COUNTERS_CAPACITY_MIN, 0 ),
+        m_used( 0 ), m_mask( COUNTERS_CAPACITY_MIN - 1 ),
+        m_shift( 64 - __builtin_ctzll(COUNTERS_CAPACITY_MIN) )
+    {}
+
+    importance_float_t counter_matrix_t::operator()( size_t row, size_t col ) const noexcept
+    {
+        const key_t  k = key( row, col );
+        for( size_t i = slot( k ); m_keys[i] != EMPTY_KEY; i = (i + 1) & m_mask )
+            if( m_keys[i] == k )
+                return m_vals[i];
+        return 0;
+    }
+
+    void counter_matrix_t::merge( const counter_matrix_t& cm, importance_float_t scale )
+    {
+        cm.for_each([this, scale](size_t i, size_t j, importance_float_t val) {
+            add( i, j, val * scale );
+        });
+    }
+
+    void counter_matrix_t::clear()
+    {
+        if( !m_used )
+            return;
+        std::fill( m_keys.begin(), m_keys.end(), EMPTY_KEY );
+        std::fill( m_vals.begin(), m_vals.end(), 0 );
+        m_used = 0;
+    }
+
+    void counter_matrix_t::grow()
+    {
+        std::vector<key_t>  keys( m_keys.size() * 2, EMPTY_KEY );
+        std::vector<importance_float_t>  vals( keys.size(), 0 );
+        keys.swap( m_keys );
+        vals.swap( m_vals );
+        m_mask = m_keys.size() - 1;
+        --m_shift;
+        for( size_t j = 0; j < keys.size(); ++j ) {
+            if( keys[j] == EMPTY_KEY )
+                continue;
+            size_t  i = slot( keys[j] );
+            while( m_keys[i] != EMPTY_KEY )
+                i = (i + 1) & m_mask;
+            m_keys[i] = keys[j];
+            m_vals[i] = vals[j];
+        }
+    } // }}}
+
+    // events_accumulator_t implementation {{{
+    // x log2(x) considering that 0 log2(0) = 0
+    static inline importance_float_t xlog2x( importance_float_t x )
+    {
+        return x > 0 ? x * log2( x ) : 0;
+    }
+
+    events_accumulator_t::events_accumulator_t( size_t rows, size_t cols ):
+        m_cells( rows, cols ), m_rows( rows, 0 ), m_cols( cols, 0 ), m_total( 0 ),
+        m_cells_xlx( 0 ), m_rows_xlx( 0 ), m_cols_xlx( 0 )
+    {}
+
+    void events_accumulator_t::merge( const counter_matrix_t& cm, importance_float_t scale )
+    {
+        // Update the cells and the marginals accumulating the changes of their x log2(x)
+        cm.for_each([this, scale](size_t i, size_t j, importance_float_t val) {
+            val *= scale;
+            auto&  cell = m_cells.at( i, j );
+            m_cells_xlx += xlog2x( cell + val ) - xlog2x( cell );
+            cell += val;
+            auto&  row = m_rows[i];
+            m_rows_xlx += xlog2x( row + val ) - xlog2x( row );
+            row += val;
+            auto&  col = m_cols[j];
+            m_cols_xlx += xlog2x( col + val ) - xlog2x( col );
+            col += val;
+            m_total += val;
+        });
+    }
+
+    importance_float_t events_accumulator_t::entropy_rows() const noexcept
+    {
+        return m_total > 0 ? log2( m_total ) - m_rows_xlx / m_total : 0;
+    }
+
+    importance_float_t events_accumulator_t::entropy_cols() const noexcept
+    {
+        return m_total > 0 ? log2( m_total ) - m_cols_xlx / m_total : 0;
+    }
+
+    importance_float_t events_accumulator_t::mutual_info() const noexcept
+    {
+        return m_total > 0 ? log2( m_total ) + (m_cells_xlx - m_rows_xlx - m_cols_xlx) / m_total : 0;
+    } // }}}
+
     // void normalize_events( cm, out_double_mat, out_cols, out_rows ) {{{
     //    Here `normalized' means just "divided by the total so that sum
     //    of frequencies/probabilities be one". It doesn't have anything to
@@ -28,48 +145,71 @@ namespace gecmi {
         )
     {
         // First I need to calculate the total number of events
-        if(total_events <= 0) {
-            total_events = 0;
-            for( auto int2size: cm.data() )
-            {
-                total_events += int2size.second ;
-            }
-        }
-        // That was easy... now I need to reallocate
-        // the matrix dimensions on the output
-        out_norm_conf.resize( cm.size1(), cm.size2() , false );
-        out_norm_conf.clear();
-
-        // And finally put the numbers there... again,
-        // easy enough
-        for( auto int2size: cm.data() )
-            out_norm_conf.data()[ int2size.first ] = int2size.second / total_events;
-
-        // Now time to populate the cols and rows vectors
-        out_norm_cols.resize( cm.size2() );
-        out_norm_cols.clear();
-        out_norm_rows.resize( cm.size1() );
-        out_norm_rows.clear();
-        size_t col_count = cm.size2();
-#ifdef DEBUG
-//    #define SHOW_MTNORM
-//    puts(">> normalize_events(), normalized matrix: ");
-#endif // DEBUG
-        for( auto int2p: out_norm_conf.data() )
+        if(total_events <= 0)
+            total_events = total_events_from_unmi_cm( cm );
+
+        // Compact the cells ordering them by (row, col): bucket them by rows
+        // and then sort each row by columns (rows are typically short)
+        const size_t  rows = cm.size1();
+        const size_t  cols = cm.size2();
+        std::vector<size_t>  rptrs( rows + 1, 0 );  // Row pointers (CSR)
+        cm.for_each([&rptrs](size_t i, size_t, importance_float_t) {
+            ++rptrs[i + 1];
+        });
+        for( size_t i = 0; i < rows; ++i )
+            rptrs[i + 1] += rptrs[i];
+
+        out_norm_conf.rows = rows;
+        out_norm_conf.cols = cols;
+        const size_t  nnz = cm.nnz();
+        auto&  crow = out_norm_conf.row;
+        auto&  ccol = out_norm_conf.col;
+        auto&  cval = out_norm_conf.val;
+        crow.resize( nnz );
+        ccol.resize( nnz );
+        cval.resize( nnz );
         {
-            importance_float_t p = int2p.second ;
-            size_t g = int2p.first;
-            // g = i*n+j
-            size_t j = g % col_count;
-            size_t i = g / col_count;
-#ifdef SHOW_MTNORM
-            printf(" %0.3G", p);
-            if(j == col_count - 1)
-                puts("");
-#endif // SHOW_MTNORM
-            out_norm_cols(j) += p ;
-            out_norm_rows(i) += p ;
+            std::vector<size_t>  pos( rptrs.begin(), rptrs.end() - 1 );
+            cm.for_each([&](size_t i, size_t j, importance_float_t val) {
+                const size_t  k = pos[i]++;
+                crow[k] = i;
+                ccol[k] = j;
+                cval[k] = val / total_events;
+            });
         }
+        // Sort the rows and evaluate the row marginals in parallel
+        out_norm_rows.assign( rows, 0 );
+        tbb::parallel_for( tbb::blocked_range<size_t>( 0, rows, MARGINALS_GRAIN ),
+            [&](const tbb::blocked_range<size_t>& r) {
+                std::vector<std::pair<uint32_t, importance_float_t>>  rcells;  // Cells of the row
+                for( size_t i = r.begin(); i < r.end(); ++i ) {
+                    const size_t  ib = rptrs[i];
+                    const size_t  ie = rptrs[i + 1];
+                    if( ie - ib >= 2 ) {
+                        rcells.clear();
+                        for( size_t k = ib; k < ie; ++k )
+                            rcells.emplace_back( ccol[k], cval[k] );
+                        std::sort( rcells.begin(), rcells.end(),
+                            [](const std::pair<uint32_t, importance_float_t>& a,
+                            const std::pair<uint32_t, importance_float_t>& b) {
+                                return a.first < b.first;
+                            });
+                        for( size_t k = ib; k < ie; ++k ) {
+                            ccol[k] = rcells[k - ib].first;
+                            cval[k] = rcells[k - ib].second;
+                        }
+                    }
+                    importance_float_t  rsum = 0;
+                    for( size_t k = ib; k < ie; ++k )
+                        rsum += cval[k];
+                    out_norm_rows[i] = rsum;
+                }
+            });
+
+        // Now time to populate the cols vector (marginals)
+        out_norm_cols.assign( cols, 0 );
+        for( size_t k = 0; k < nnz; ++k )
+            out_norm_cols[ccol[k]] += cval[k];
     } // }}}
 
 //    // void normalize_events_with_fails( int_mat, out_double_mat ) {{{
@@ -106,7 +246,7 @@ namespace gecmi {
 //    } // }}}
 
     // importance_float_t zlog( importance_float_t x ) {{{
-    importance_float_t zlog( importance_float_t x )
+    inline importance_float_t zlog( importance_float_t x )
     {
         return x >= eps ? log2( x ) : 0;  // Note: to have x*log(x) = 0 instead of -inf
         // Matching of the same clusters should yield 1, -1 considering that returning log vals are negative
@@ -114,34 +254,59 @@ namespace gecmi {
         //return x <= 1 - eps ? x >= eps ? log2( x ) : 0 : -1;
     } // }}}
 
+    // importance_float_t mi_terms( norm_conf, norm_cols, norm_rows, begin, end ) {{{
+    //    Sum of the mutual information terms of the cells [begin, end)
+    //    Note: the terms are evaluated by blocks: the flat loops of the arguments and
+    //    logarithms are separated from the gathering of the marginals
+    static importance_float_t mi_terms(
+        importance_matrix_t const& norm_conf,
+        importance_vector_t const& norm_cols,
+        importance_vector_t const& norm_rows,
+        size_t begin, size_t end
+    )
+    {
+        constexpr size_t  BLOCK = 256;
+        importance_float_t  margs[BLOCK];  // Products of the marginals of the cells
+        const importance_float_t* const  vals = norm_conf.val.data();
+        importance_float_t ni = 0.0;
+        for( size_t kb = begin; kb < end; kb += BLOCK ) {
+            const size_t  ke = std::min( kb + BLOCK, end );
+            for( size_t k = kb; k < ke; ++k )
+                margs[k - kb] = norm_cols[norm_conf.col[k]] * norm_rows[norm_conf.row[k]];
+            for( size_t k = kb; k < ke; ++k )
+                ni += vals[k] * zlog( vals[k] / margs[k - kb] );
+        }
+        return ni;
+    } // }}}
+
     // importance_float_t unnormalized_mi( norm_conf, norm_cols, norm_rows ) {{{
     //    Input matrix and columns are normalized with respect to probabilities,
     //    so that all sum one; not divided by semi-sum of entropies or anything
     //    like that.
+    //    Note: the deterministic reduction yields the same result for any number of threads
     importance_float_t unnormalized_mi(
         importance_matrix_t const& norm_conf,
         importance_vector_t const& norm_cols,
         importance_vector_t const& norm_rows
     )
     {
-        // First the unnormalized mutual information... shouldnt
-        // be too hard
-        importance_float_t ni = 0.0;
-        size_t col_count = norm_conf.size2();
-        for( auto int2p: norm_conf.data() )
-        {
-            importance_float_t p = int2p.second ;
-            size_t g = int2p.first;
-            // g = i*n+j
-            size_t j = g % col_count;
-            size_t i = g / col_count;
-            ni += p*zlog(
-                p / (
-                    norm_cols(j) * norm_rows(i)
-                )
-            );
-        }
-        return ni;
+        return tbb::parallel_deterministic_reduce(
+            tbb::blocked_range<size_t>( 0, norm_conf.nnz(), REDUCTION_GRAIN ), importance_float_t( 0 ),
+            [&](const tbb::blocked_range<size_t>& r, importance_float_t ni) {
+                return ni + mi_terms( norm_conf, norm_cols, norm_rows, r.begin(), r.end() );
+            }, std::plus<importance_float_t>() );
+    } // }}}
+
+    // importance_float_t entropy( probs ) {{{
+    importance_float_t entropy( importance_vector_t const& probs )
+    {
+        return tbb::parallel_deterministic_reduce(
+            tbb::blocked_range<size_t>( 0, probs.size(), REDUCTION_GRAIN ), importance_float_t( 0 ),
+            [&probs](const tbb::blocked_range<size_t>& r, importance_float_t h) {
+                for( size_t i = r.begin(); i < r.end(); ++i )
+                    h -= probs[i] * zlog( probs[i] );
+                return h;
+            }, std::plus<importance_float_t>() );
     } // }}}
 
     // importance_float_t normalized_mi( norm_conf, norm_cols, norm_rows ) {{{
@@ -154,54 +319,42 @@ namespace gecmi {
         importance_vector_t const& norm_rows
     )
     {
-        // First the unnormalized mutual information... shouldnt
-        // be too hard
-        importance_float_t ni = 0.0;
-        size_t col_count = norm_conf.size2();
-        for( auto int2p: norm_conf.data() )
-        {
-            importance_float_t p = int2p.second ;
-            size_t g = int2p.first;
-            // g = i*n+j
-            size_t j = g % col_count;
-            size_t i = g / col_count;
-            // Rows are indexed using i, so, norm_rows are the
-            // marginal probabilities of all the rows, and we can visualize
-            // it as a column vector. Similarly, we can visualize norm_cols as
-            // a row vector (although it is the sum, column-wize, of all
-            ni += p*zlog(
-                p / (
-                    norm_cols(j) * norm_rows(i)
-                )
-            );
-        }
+        const importance_float_t ni = unnormalized_mi( norm_conf, norm_cols, norm_rows );
         // Now the entropies and the normalization
-        importance_float_t H0 = 0.0;
-        double s = 0.0;
-        for( importance_float_t p: norm_cols )
-        {
-            H0 -= p * zlog( p );
-            s += p;
-        }
-        //cout << "H0: " << H0 << " s " << s << endl;
-        importance_float_t H1 = 0.0;
-        s = 0.0;
-        for( importance_float_t p: norm_rows )
-        {
-            H1 -= p * zlog( p );
-            s += p;
-        }
-        //cout << "H1: " << H1 << " s " << s << endl;
+        const importance_float_t H0 = entropy( norm_cols );
+        const importance_float_t H1 = entropy( norm_rows );
         importance_float_t result = 2*ni / ( H0 + H1 );
         return result;
     } // }}}
 
-    // void variances_at_prob( nconf, ncols, nrows, n, threshold_prob, &out_max_variance, &out_nmi ) {{{
-    void variances_at_prob(
+    // void evaluate_nmi( norm_conf, norm_cols, norm_rows, &out_nmi, &out_nmi_sqrt ) {{{
+    void evaluate_nmi(
         importance_matrix_t const& norm_conf,
         importance_vector_t const& norm_cols,
         importance_vector_t const& norm_rows,
-        int64_t total_events,
+        double & out_nmi,  //  NMI max
+        double & out_nmi_sqrt
+    )
+    {
+        const importance_float_t  unmi = unnormalized_mi( norm_conf, norm_cols, norm_rows );
+        const importance_float_t  H0 = entropy( norm_cols );
+        const importance_float_t  H1 = entropy( norm_rows );
+
+        // Note: the same conventions as in variances_at_prob() are used for the degenerate cases
+        const importance_float_t  aggEps = std::max(norm_cols.size(), norm_rows.size()) * eps;
+        out_nmi = unmi >= eps ? unmi / std::max( H0 , H1 )
+          : (H0 >= aggEps || H1 >= aggEps ? 0 : 1);
+        out_nmi_sqrt = unmi >= eps ? unmi / std::sqrt( H0 * H1 )
+          : (H0 >= aggEps || H1 >= aggEps ? 0 : 1);
+#ifdef DEBUG
+        std::cerr << "> evaluate_nmi(), H0: " << H0 << ", H1: " << H1 << ", unmi: " << unmi
+            << ", nmi: " << out_nmi << ", nmi_sqrt: " << out_nmi_sqrt << std::endl;
+#endif // DEBUG
+    } // }}}
+
+    // void variances_at_prob( events, threshold_prob, &out_max_variance, &out_nmi, &out_nmi_sqrt ) {{{
+    void variances_at_prob(
+        events_accumulator_t const& events,
         double prob,
         double & out_max_variance,
         double & out_nmi,  //  NMI max
@@ -214,75 +367,25 @@ namespace gecmi {
         // Start with zero
         out_max_variance = 0;
 
-        // Now I need to go as if yo calculate the mutual information completely.
-        // But then I also need to keep intermediate magnitudes so that
-        // I can go back and forth easily.
-
-        // First the unnormalized mutual information... shouldnt
-        // be too hard
-        importance_float_t ni = 0.0;
-        size_t col_count = norm_conf.size2();
+        const importance_float_t  total = events.total();
+        const importance_vector_t&  cols = events.cols();
+        const importance_vector_t&  rows = events.rows();
 
+        // The entropies and the unnormalized mutual information are maintained
+        // by the accumulator incrementally
+        const importance_float_t  H0 = events.entropy_cols();
+        const importance_float_t  H1 = events.entropy_rows();
+        // Note: the accumulated rounding error is bounded by the theoretical limits of MI
+        const importance_float_t  unmi = std::min( std::max<importance_float_t>( events.mutual_info(), 0 )
+            , std::min( H0, H1 ) );
 
-        for( auto int2p: norm_conf.data() )
-        {
-            importance_float_t p = int2p.second ;
-
-            //check_total_one += p;
-
-            size_t g = int2p.first;
-            // g = i*n+j
-            size_t j = g % col_count;
-            size_t i = g / col_count;
-            // Rows are indexed using i, so, norm_rows are the
-            // marginal probabilities of all the rows, and we can visualize
-            // it as a column vector. Similarly, we can visualize norm_cols as
-            // a row vector (although it is the sum, column-wize, of all
-            ni += p*zlog(
-                p / (
-                    norm_cols(j) * norm_rows(i)
-                )
-            );
-#ifdef DEBUG
-            printf("> variances_at_prob(), ni: %G,  p: %G, zlvar: %G (ncv_%lu: %G, nrv_%lu: %G)\n"
-                , ni, p, zlog( p / (norm_cols(j) * norm_rows(i)) ), j, norm_cols(j), i, norm_rows(i));
-#endif // DEBUG
-        }
-
-
-        // Now the entropies
-        double s = 0.0;
-        //double check_total_one = 0.0;
-        importance_float_t H0 = 0;
-        for( importance_float_t p: norm_cols )
-        {
-#ifdef DEBUG
-            assert(p > -eps && p < 1 + eps && "variances_at_prob(), H0 p is invalid");
-#endif // DEBUG
-            H0 -= p * zlog( p );
-            s += p;
-        }
-
-        importance_float_t H1 = 0.0;
-        s = 0.0;
-        for( importance_float_t p: norm_rows )
-        {
-#ifdef DEBUG
-            assert(p > -eps && p < 1 + eps && "variances_at_prob(), H1 p is invalid");
-#endif // DEBUG
-            H1 -= p * zlog( p );
-            s += p;
-        }
-
-        const importance_float_t  aggEps = std::max(norm_cols.size(), norm_rows.size()) * eps;
-        importance_float_t unmi = ni;
+        const importance_float_t  aggEps = std::max(cols.size(), rows.size()) * eps;
         importance_float_t nmi = unmi >= eps ? unmi / std::max( H0 , H1 )
           : (H0 >= aggEps || H1 >= aggEps ? 0 : 1);
 
 #ifdef DEBUG
-        std::cerr << "> variances_at_prob(), psum: "  << s << ", H0: " << H0 << ", H1: "
+        std::cerr << "> variances_at_prob(), total: "  << total << ", H0: " << H0 << ", H1: "
             << H1 << ", unmi: " << unmi << ", nmi: " << nmi << std::endl;
-        assert(ni > -eps && "variances_at_prob(), nmi is invalid");
         assert(H0 >= 0 && H1 >= 0 && "variances_at_prob(), H0 or H1 is invalid");
 #endif // DEBUG
 
@@ -291,48 +394,37 @@ namespace gecmi {
         // vector will be big.
         //size_t alpha_size = norm_conf.size1() * norm_conf.size2();
 
-        importance_float_t s2 = 0.0;
-        static_assert(std::is_integral<decltype(total_events)>::value
-            , "variances_at_prob(), total_events should be integer here");
+        const int64_t  total_events = total;
+        const counter_matrix_t&  cells = events.cells();
+        //binomial bn( total_events, p );
+        //  This is  the lower point where with probability
+        // `prob' we can go.
+        //double pp = quantile( bn, prob ) / total_events;
+        // To understand this formula please check "more_about_the_error.nb"
+        // Note: pp = 1 - ibeta_inv(total_events - success_count, success_count + 1, prob)
+        beta_quantiles  quantiles( total_events, prob );
+        cells.for_each([&](size_t, size_t, importance_float_t val) {
+            quantiles.require( int64_t( val / total * total_events ) );
+        });
+        quantiles.evaluate();
+
         // Now I'm goint fo calculate the error components...
-        for( auto int2p: norm_conf.data() )
+        // Note: the cells are normalized on the fly, the deterministic reduction yields
+        // the same result for any number of threads
+        const auto  cell_variance = [&](size_t i, size_t j, importance_float_t val) -> importance_float_t
         {
             // This prob is what is
-            importance_float_t p = int2p.second ;
+            importance_float_t p = val / total ;
             int64_t success_count =  p * total_events ;
-
-            //binomial bn( total_events, p );
-            //  This is  the lower point where with probability
-            // `prob' we can go.
-            //double pp = quantile( bn, prob ) / total_events;
-
-            // To understand this formula please check "more_about_the_error.nb"
-            double pp = 1.0;
-            if(total_events != success_count)
-                pp -= boost::math::ibeta_inv(
-                  total_events - success_count,
-                  success_count + 1,
-                  prob );
-
-            //std::cout <<
-                //boost::format( "total_events %1% success_count %2% prob %3%" )
-                    //% total_events
-                    //% success_count
-                    //% prob
-                //<< std::endl;
+            const double  pp = quantiles.quantile( success_count );
 
             //double pp = quantile( bn, 0.50 ) / total_events;  // <--- For verification
             //std::cout << "p : " << p << " pp: " << pp << std::endl;
 
-            // 'g' is the general index inside the data array of the matrix.
-            size_t g = int2p.first;
-            // g = i*col_count + j  <-- That's how it is related to rows and cols
-            size_t j = g % col_count;
-            size_t i = g / col_count;
             // Now I need to calculate what would be if
             // we use the quantile...
-            importance_float_t h0used = norm_cols( j );
-            importance_float_t h1used = norm_rows( i );
+            importance_float_t h0used = cols[ j ] / total;
+            importance_float_t h1used = rows[ i ] / total;
             // Anulate old value used there... note inversion
             // of signs
             importance_float_t h0 = H0 + h0used * zlog( h0used );
@@ -340,7 +432,6 @@ namespace gecmi {
             importance_float_t h0new = h0used - p + pp ;
             // Put it in place... note inversion of signs
             h0 -= h0new * zlog( h0new );
-            //cout << "H0 " << H0 << " h0 " << h0 << endl;
 
             // Anulate old value used there... note inversion
             // of signs
@@ -349,23 +440,17 @@ namespace gecmi {
             importance_float_t h1new = h1used - p + pp ;
             // Put it in place... note inversion of signs
             h1 -= h1new * zlog( h1new );
-            //cout << "H1 " << H1 << " h1 " << h1 << endl;
 
-            // Rows are indexed using i, so, norm_rows are the
+            // Rows are indexed using i, so, the row marginals are the
             // marginal probabilities of all the rows, and we can visualize
-            // it as a column vector. Similarly, we can visualize norm_cols as
-            // a row vector.
+            // it as a column vector. Similarly, we can visualize the column
+            // marginals as a row vector.
 
             // Suppressing old effect
-            importance_float_t old_summand = p*zlog(
-                p / (
-                    norm_cols(j) * norm_rows(i)
-                ));
-            //cout << "old summand " << old_summand << std::endl;
-            ni = unmi - old_summand;
+            importance_float_t old_summand = p*zlog( p / ( h0used * h1used ) );
+            importance_float_t ni = unmi - old_summand;
             // Putting new effect
             importance_float_t new_summand = pp*zlog( pp / ( h0new * h1new ) );
-            //cout << "new summand " << new_summand << std::endl;
 
             ni += new_summand;
 
@@ -376,8 +461,16 @@ namespace gecmi {
 
             importance_float_t var = nv - nmi ;
 
-            s2 += var*var;
-        }
+            return var*var;
+        };
+        const importance_float_t  s2 = tbb::parallel_deterministic_reduce(
+            tbb::blocked_range<size_t>( 0, cells.slots(), VARIANCE_GRAIN ), importance_float_t( 0 ),
+            [&cells, &cell_variance](const tbb::blocked_range<size_t>& r, importance_float_t s2) {
+                cells.for_each([&s2, &cell_variance](size_t i, size_t j, importance_float_t val) {
+                    s2 += cell_variance( i, j, val );
+                }, r.begin(), r.end());
+                return s2;
+            }, std::plus<importance_float_t>() );
         out_max_variance = std::sqrt( s2 );
         // ATTENTION: for some cases, for example when one of the collections is a single cluster,
         // NMI will always yield 0 for any clusters in the second collection, which is limitation
@@ -397,27 +490,11 @@ namespace gecmi {
     )
     {
         importance_float_t total_events = 0.0;
-        for( auto int2size: cm.data() )
-        {
-            total_events += int2size.second ;
-        }
+        cm.for_each([&total_events](size_t, size_t, importance_float_t val) {
+            total_events += val ;
+        });
 
         return total_events;
     }
 
-    importance_matrix_t transpose(const importance_matrix_t& sm)
-    {
-        importance_matrix_t  rm(sm.size2(), sm.size1());  // Resulting matrix returned using NRVO optimization
-
-        const size_t  srsize = sm.size2();  // Row size;
-        for(auto val: sm.data())
-        {
-            size_t i = val.first / srsize;
-            size_t j = val.first % srsize;
-            rm(j, i) = val.second;
-            //assert(val.second == sm(i, j) && "transpose(), values validation failed");
-        }
-        return rm;
-    }
-
 } // namespace gecmi
@@ -7,6 +7,7 @@
 #include "representants.hpp"
 #include "player_automaton.hpp"
 #include "deep_complete_simulator.hpp"
+#include "random_generator.hpp"
 
 
 namespace gecmi {
@@ -25,30 +26,41 @@ struct deep_complete_simulator::pimpl_t {
     //
     //   I need a random number generator that picks up a random vertex
     //   in the set of remaining vertices.
+    //   Each fork (worker) has own generator, which is reseeded from the base seed
+    //   and the absolute index of the sample (counter-based randomness), so that
+    //   the samples do not depend on the work partitioning between the threads.
     //
-    static random_device rd;
+    static uint64_t seedbase;  // Base seed of the generators
     static size_t invdrisk;  // Inverted doubled risk (probability the value being outside)
 
-    typedef std::mt19937 randgen_t;
-    typedef std::mt19937::result_type  gen_seed_t;
-    typedef std::uniform_int_distribution<uint32_t>  linear_distrib_t;
+    typedef xoshiro256ss randgen_t;
+    typedef randgen_t::result_type  gen_seed_t;
     typedef std::vector< importance_float_t > importance_vector_t;
 
-    // For keeping the bi-correspondences; Two vertex to modules bimaps
+    // For keeping the bi-correspondences; Two vertex to modules indexes
     two_relations_ref tworel;
 
     // The random number generator and everything else
     randgen_t rndgen;
-    linear_distrib_t  lindis;
 
     // Input vertices
     vertices_t&  verts;
+    // Origin vertices of the retried samples if differ from verts
+    const std::vector<vmid_t>*  rverts;
 
+    // Scratch buffers reused by the samples to avoid memory allocations in the steady state
+    module_set_t  rm1, rm2;  // Modules of the current vertex
+    module_set_t  pms1, pms2;  // Remaining modules of the player automatons
+    module_set_t  tmp;  // Temporary set for the operations of the player automatons
 
-    pimpl_t( two_relations_ref tworels, vertices_t& vertices, gen_seed_t seed=rd() ):
+
+    pimpl_t( two_relations_ref tworels, vertices_t& vertices, const std::vector<vmid_t>* rvertices
+        , gen_seed_t seed=seedbase ):
         tworel( tworels ), rndgen( seed ),
-        lindis(0, vertices.size() - 1),
-        verts(vertices)  {}
+        verts(vertices), rverts(rvertices), rm1(), rm2(), pms1(), pms2(), tmp()  {}
+
+    pimpl_t(const pimpl_t&) = delete;
+    pimpl_t& operator=(const pimpl_t&) = delete;
 
 //    ~pimpl_t()
 //    {
@@ -60,28 +72,32 @@ struct deep_complete_simulator::pimpl_t {
     // Given a vertex, populate two sets of modules
     // with the corresponding modules according to
     // each correspondence.
-    void get_modules( size_t vertex, module_set_t& mset1, module_set_t& mset2) const
+    // Note: the orientation is reversed when rel1 is the second collection
+    static void get_modules( size_t vertex, const vertex_module_index_t& rel1
+        , const vertex_module_index_t& rel2, module_set_t& mset1, module_set_t& mset2)
     {
         mset1.clear();
         mset2.clear();
 
         gecmi::get_modules(
             vertex,
-            tworel.first,
-            tworel.second,
+            rel1,
+            rel2,
             mset1,
             mset2 );
     }
 
-    simulation_result_t get_sample()
+    bool get_sample(simulation_result_t& result, bool reversed)
     {
-        simulation_result_t result;
+        result.importance = 0;
+        result.mods1.clear();
+        result.mods2.clear();
         uint32_t attempt_count = 0;
         uint32_t failed_attempts = 0;
         while(result.mods1.empty() || result.mods2.empty())
         {
             //cout << "-" << endl;
-            try_get_sample( result );  // The most heavy function !!!
+            try_get_sample( result, reversed, attempt_count );  // The most heavy function !!!
             //// Note: exact match provides more accurate results than approximate fuzzy match
             //// and additionally ~ satisfies usecase 1lev4nds
             //// !!! After the proper normalization (importance) the results for hard and soft match are approximately the same !!!
@@ -91,39 +107,48 @@ struct deep_complete_simulator::pimpl_t {
             if ( ++attempt_count >= MAX_ACCEPTABLE_FAILURES ) {
                 // Note: it's better to yield approximate results than absence of any results at all
                 //throw std::domain_error("SystemIsSuspiciuslyFailingTooMuch dcs (maybe your partition is not solvable?)\n");
-                fprintf(stderr, "WARNING get_sample(), the partition is not solvable, results are approximate");
+                // Note: the failures are counted by the caller and reported once per run
                 result.mods1.clear();
                 result.mods2.clear();
                 result.importance = 0;
-                break;
+                return false;
             }
         }
 
         if(failed_attempts >= 1 && failed_attempts < MAX_ACCEPTABLE_FAILURES)
             result.importance *= importance_float_t(attempt_count - failed_attempts) / attempt_count;
+        // Yield the modules in the direct orientation: mods1 belong to the first collection
+        if(reversed)
+            std::swap(result.mods1, result.mods2);
         // Note: typically the number of attempts is 1
         //if(attempt_count  > 1)
         ////    fprintf(stderr, "Attempts: %u\n", attempt_count);
         //    cout << "Attempts: " <<  attempt_count << endl;
-        return result;
+        return true;
     }
 
     // optional<...> try_get_sample() {{{
     //    This is indeed a huge method.
-    void try_get_sample(simulation_result_t& result)  // The most heavy function !!!
+    // retry  - the sample is retried after the failed attempt
+    void try_get_sample(simulation_result_t& result, bool reversed, bool retry)  // The most heavy function !!!
     {
+        // Relations in the sampling orientation
+        const vertex_module_index_t&  rel1 = reversed ? tworel.second : tworel.first;
+        const vertex_module_index_t&  rel2 = reversed ? tworel.first : tworel.second;
         // Get the sets of modules (from 2 clusterings/partitions) for the first vertex
         // Note: verts is array of indices
         size_t ivetr;
-        size_t vertex;  // = verts[lindis(rndgen)];  // 0, rndgen, rd
-        module_set_t rm1, rm2;
+        size_t vertex;
         // Note: some vertices might be outlier that are not present in any modules, skip them
         {
             size_t  i = 0;
-            const size_t  imax = verts.size();
+            // Note: the retried samples start from any base vertex when only a subset of them is sampled
+            const bool  rbase = retry && rverts;
+            const size_t  imax = rbase ? rverts->size() : verts.size();
             do {
-                vertex = verts[ivetr = lindis(rndgen)];
-                get_modules( vertex, rm1, rm2 );
+                const uint32_t  iv = reduce_range(rndgen() >> 32, imax);
+                vertex = rbase ? (*rverts)[iv] : verts[ivetr = iv];
+                get_modules( vertex, rel1, rel2, rm1, rm2 );
                 // Use vertex that occurs in any module, otherwise take another vertex
             } while(!rm1.size() && !rm2.size() && ++i < imax);
             if(i == imax)
@@ -135,8 +160,7 @@ struct deep_complete_simulator::pimpl_t {
         // but with confidence ~ (1 - 0.032 / 2): 31 attempts * modules size is enough
         const size_t  attempts = (rm1.size() + rm2.size()) * invdrisk; // 31; /(risk*2)
         // The automatons that track the state
-        //player_automaton pa1(move(rm1)), pa2(move(rm2));
-        player_automaton pa1(rm1), pa2(rm2);
+        player_automaton pa1(rm1, pms1, tmp), pa2(rm2, pms2, tmp);
         // So, when we have to calculate the probability
         // even on the case that pa1 and pa2 be already
         // set to "ready", I will report the correct
@@ -155,19 +179,17 @@ struct deep_complete_simulator::pimpl_t {
             && ++used_vertex_index <= attempts
         ) {
             // Parameters for the second vertex
-            static_assert(std::is_integral<decltype(rd())>::value && std::is_unsigned<decltype(rd())>::value
-                , "try_get_sample(), rd() value has unexpected type\n");
-            // Note: rd() might return the same values on parallel execution, but not lindis.
-            const auto  iv2 = lindis(rndgen) ^ rd();  // rndgen, rd
+            static_assert(std::is_integral<decltype(rndgen())>::value && std::is_unsigned<decltype(rndgen())>::value
+                , "try_get_sample(), rndgen() value has unexpected type\n");
+            // Note: the estimate depends on the coupled modulo selections, 32-bit operands make them cheaper
+            const uint32_t  iv2 = rndgen() >> 32;
             bool  v2first = iv2 % 2;
             // Take modules from clustering 1 or 2 relevant to the origin vertex
-            module_set_t  v2bms = move(v2first ? rm1 : rm2);  // Base modules for v2
             // ATTENTION: a single selected module set can be empty
             // if node base is not synced (differs for the left/right collections)
-            if(v2bms.empty()) {
-                v2bms = move(v2first ? rm2 : rm1);
+            if((v2first ? rm1 : rm2).empty())
                 v2first = !v2first;
-            }
+            const module_set_t&  v2bms = v2first ? rm1 : rm2;  // Base modules for v2
 #ifdef DEBUG
             if(v2bms.empty())
                 fprintf(stderr, "try_get_sample(), rm1: %lu, rm2: %lu, uvi: %lu\n"
@@ -175,30 +197,27 @@ struct deep_complete_simulator::pimpl_t {
             assert(!v2bms.empty() && "try_get_sample(), both selected module sets shouldn't be empty");
 #endif // DEBUG
             // Select module (cluster) from which v2 will be selected
-            auto  iv2mod = v2bms.begin();
-            advance(iv2mod, iv2 % v2bms.size());
-            const auto&  mtov = (v2first ? tworel.first : tworel.second).right;
-            // Get range of the target vertices from the chosen module (cluster) to select v2
-            auto  iverts = mtov.equal_range(*iv2mod);
+            const auto  iv2mod = v2bms[iv2 % uint32_t(v2bms.size())];
+            // Get the target vertices from the chosen module (cluster) to select v2
+            const auto  mverts = (v2first ? rel1 : rel2).members(iv2mod);
 #ifdef DEBUG
-            assert(iverts.first != iverts.second && iverts.first->first == *iv2mod
-                && "try_get_sample(), the module must have back relation to the vertex");
+            assert(!mverts.empty() && "try_get_sample(), the module must have back relation to the vertex");
 #endif // DEBUG
-            auto ivt = iverts.first;
-            advance(ivt, (iv2 + used_vertex_index) % distance(iverts.first, iverts.second));
+            const uint32_t  iv2step = iv2 + used_vertex_index;
+            size_t  ivt = iv2step % uint32_t(mverts.size());
             // Do not take the same vertex
-            if(ivt->second == vertex && ++ivt == iverts.second)
-                ivt = iverts.first;
+            if(mverts[ivt] == vertex && ++ivt == mverts.size())
+                ivt = 0;
             // Consider the case of single vertex module(s), which is a RARE case
-            if(ivt->second == vertex) {
-                // Recover moved rm module(s)
+            if(mverts[ivt] == vertex) {
+                // Take the remaining modules as the base for the next vertex
                 rm1 = pa1.get_modules();
                 rm2 = pa2.get_modules();
                 continue;
             }
-            vertex = ivt->second;  // Get the target vertex
+            vertex = mverts[ivt];  // Get the target vertex
 
-            get_modules( vertex, rm1, rm2 );
+            get_modules( vertex, rel1, rel2, rm1, rm2 );
             // Consider early exit for the exact match
             if(rm1.size() == 1 && rm2.size() == 1) {
                 //result.importance = 1;  // Exact match
@@ -208,8 +227,7 @@ struct deep_complete_simulator::pimpl_t {
                 return;
             }
             // Now get the operation
-            // Note: lindis(rndgen) gives better quality faster than rd()
-            bool do_intersection = (iv2 + used_vertex_index) % 2;  // (used_vertex_index + initial_iv2) % 2;  lindis(rndgen) % 2, used_vertex_index % 2
+            bool do_intersection = iv2step % 2;
             pa1.set_operation_kind( do_intersection );
             pa2.set_operation_kind( do_intersection );
             importance += 1.0 / std::max<size_t>(sqrt(rm1.size() * rm2.size()), 1);  // The more common vertex the less it is important
@@ -230,7 +248,7 @@ struct deep_complete_simulator::pimpl_t {
 
 }; // pimpl_t
 
-random_device deep_complete_simulator::pimpl_t::rd;
+uint64_t deep_complete_simulator::pimpl_t::seedbase = uint64_t(random_device()()) << 32 | random_device()();
 size_t deep_complete_simulator::pimpl_t::invdrisk = 1 / (0.01 * 2);  // Note: the actual value set later E (0. 1]
 
 void deep_complete_simulator::risk(double r)
@@ -243,9 +261,17 @@ void deep_complete_simulator::risk(double r)
 
 double deep_complete_simulator::risk() noexcept  { return 1. / (pimpl_t::invdrisk * 2); }
 
+void deep_complete_simulator::seed(uint64_t s) noexcept
+{
+    pimpl_t::seedbase = s;
+}
+
+uint64_t deep_complete_simulator::seed() noexcept  { return pimpl_t::seedbase; }
+
 // Required for initialization
-deep_complete_simulator::deep_complete_simulator( two_relations_ref vmb, vertices_t& verts )
-: impl(new pimpl_t(vmb, verts))  {}
+deep_complete_simulator::deep_complete_simulator( two_relations_ref vmb, vertices_t& verts
+    , const std::vector<vmid_t>* rverts )
+: impl(new pimpl_t(vmb, verts, rverts))  {}
 
 // Required for pimpl
 deep_complete_simulator::~deep_complete_simulator()
@@ -271,15 +297,20 @@ auto deep_complete_simulator::operator= (deep_complete_simulator&& dcs) noexcept
     return *this;
 }
 
-simulation_result_t deep_complete_simulator::get_sample() const
+void deep_complete_simulator::reseed(uint64_t sample) noexcept
+{
+    impl->rndgen.seed(counter_seed(pimpl_t::seedbase, sample));
+}
+
+bool deep_complete_simulator::get_sample(simulation_result_t& result, bool reversed) const
 {
-    return impl->get_sample();
+    return impl->get_sample(result, reversed);
 }
 
 // Deterministic fork...
 deep_complete_simulator deep_complete_simulator::fork() const
 {
-    return deep_complete_simulator( impl->tworel, impl->verts );
+    return deep_complete_simulator( impl->tworel, impl->verts, impl->rverts );
 }
 
 }  // gecmi
@@ -0,0 +1,53 @@
+#include <iterator>  // istreambuf_iterator
+
+#ifdef __unix__
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif // __unix__
+
+#include "mapped_input.hpp"
+
+
+namespace gecmi {
+
+mapped_input::mapped_input(std::istream& input, const char* fname)
+: addr(nullptr), len(0), mapped(false), buf()
+{
+#ifdef __unix__
+    // Map the file into the memory if possible
+    if(fname) {
+        const int  fd = open(fname, O_RDONLY);
+        struct stat  filest;
+        if(fd != -1 && !fstat(fd, &filest) && S_ISREG(filest.st_mode) && filest.st_size > 0) {
+            void*  mem = mmap(nullptr, filest.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+            if(mem != MAP_FAILED) {
+                // The content is scanned sequentially
+                madvise(mem, filest.st_size, MADV_SEQUENTIAL);
+                addr = static_cast<const char*>(mem);
+                len = filest.st_size;
+                mapped = true;
+            }
+        }
+        if(fd != -1)
+            close(fd);  // Note: the mapping remains valid after the file is closed
+        if(mapped)
+            return;
+    }
+#endif // __unix__
+    // Buffer the whole input otherwise
+    buf.assign(std::istreambuf_iterator<char>(input), std::istreambuf_iterator<char>());
+    addr = buf.data();
+    len = buf.size();
+}
+
+mapped_input::~mapped_input()
+{
+#ifdef __unix__
+    if(mapped)
+        munmap(const_cast<char*>(addr), len);
+#endif // __unix__
+}
+
+}  // gecmi
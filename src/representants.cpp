@@ -8,30 +8,23 @@ namespace gecmi{
 
     void get_modules(
         size_t vertex,
-        vertex_module_bimap_t const& vmb1,
-        vertex_module_bimap_t const& vmb2,
+        vertex_module_index_t const& vmi1,
+        vertex_module_index_t const& vmi2,
         // out
         module_set_t& out_mset1,
         module_set_t& out_mset2
         )
     {
         // A map from vertex (a single one) to the set of modules
+        // Note: the modules are sorted in the index
 
         // Get the modules 1
-        auto range = vmb1.left.equal_range(vertex);
-        for(auto ivm = range.first; ivm != range.second; ++ivm)
-			out_mset1.insert(ivm->second);
+        const auto  mods1 = vmi1.modules(vertex);
+        out_mset1.assign(mods1.begin(), mods1.end());
 
         // Get the modules 2
-        range = vmb2.left.equal_range(vertex);
-        for(auto ivm = range.first; ivm != range.second; ++ivm)
-			out_mset2.insert(ivm->second);
+        const auto  mods2 = vmi2.modules(vertex);
+        out_mset2.assign(mods2.begin(), mods2.end());
     }
 
-//    // size_t get_vertex_count( vertex_module_bimap_t const& vmb ) {{{
-//    size_t get_vertex_count( vertex_module_bimap_t& vmb )
-//    {
-//    	return uniqSize(vmb.left);
-//    } // }}}
-
 }  // gecmi
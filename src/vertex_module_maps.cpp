@@ -0,0 +1,96 @@
+#include <algorithm>  // max
+
+#include "vertex_module_maps.hpp"
+
+
+namespace gecmi {
+
+void vertex_module_index_t::build(memberships_t&& mbs)
+{
+    size_t  vend = 0;  // Upper bound of the vertex ids
+    size_t  mend = 0;  // Upper bound of the module ids
+    for(const auto& vm: mbs) {
+        vend = std::max<size_t>(vend, vm.first + 1);
+        mend = std::max<size_t>(mend, vm.second + 1);
+    }
+
+    // Fill the module to vertices relations using the counting sort retaining the input order
+    mvoffs.assign(mend + 1, 0);
+    for(const auto& vm: mbs)
+        ++mvoffs[vm.second + 1];
+    nmods = 0;
+    for(size_t i = 1; i <= mend; ++i) {
+        nmods += mvoffs[i] != 0;
+        mvoffs[i] += mvoffs[i - 1];
+    }
+    mverts.resize(mbs.size());
+    {
+        std::vector<size_t>  pos(mvoffs.begin(), mvoffs.end() - 1);  // Insertion positions
+        for(const auto& vm: mbs)
+            mverts[pos[vm.second]++] = vm.first;
+    }
+    // Release the memberships
+    memberships_t().swap(mbs);
+
+    build_vertices(vend);
+}
+
+void vertex_module_index_t::build_vertices(size_t vertices_end)
+{
+    // Count the modules of each vertex including the repeated members
+    vmoffs.assign(vertices_end + 1, 0);
+    for(auto v: mverts)
+        ++vmoffs[v + 1];
+    for(size_t i = 1; i <= vertices_end; ++i)
+        vmoffs[i] += vmoffs[i - 1];
+    vmods.resize(mverts.size());
+    {
+        std::vector<size_t>  pos(vmoffs.begin(), vmoffs.end() - 1);  // Insertion positions
+        // Note: modules are traversed in the ascending order, so they are sorted for each vertex
+        for(size_t m = 0; m + 1 < mvoffs.size(); ++m)
+            for(size_t i = mvoffs[m]; i < mvoffs[m + 1]; ++i)
+                vmods[pos[mverts[i]]++] = m;
+    }
+
+    // Omit the repeated modules of the vertices (caused by the repeated members of the module)
+    // and list the vertices having any modules
+    verts.clear();
+    size_t  ie = 0;  // End of the retained modules
+    for(size_t v = 0; v < vertices_end; ++v) {
+        const size_t  ib = ie;  // Beginning of the retained modules of the vertex
+        for(size_t i = vmoffs[v]; i < vmoffs[v + 1]; ++i)
+            if(ie == ib || vmods[ie - 1] != vmods[i])
+                vmods[ie++] = vmods[i];
+        vmoffs[v] = ib;
+        if(ie != ib)
+            verts.push_back(v);
+    }
+    verts.shrink_to_fit();
+    vmoffs[vertices_end] = ie;
+    vmods.resize(ie);
+    vmods.shrink_to_fit();
+}
+
+void vertex_module_index_t::retain_vertices(const vertex_module_index_t& base)
+{
+    // Remove all the vertices with their relations that are absent in the base collection
+    size_t  ie = 0;  // End of the retained members
+    const size_t  mend = modules_end();
+    nmods = 0;
+    for(size_t m = 0; m < mend; ++m) {
+        const size_t  ib = ie;  // Beginning of the retained members of the module
+        for(size_t i = mvoffs[m]; i < mvoffs[m + 1]; ++i)
+            if(!base.modules(mverts[i]).empty())
+                mverts[ie++] = mverts[i];
+        mvoffs[m] = ib;
+        nmods += ie != ib;
+    }
+    if(mend)
+        mvoffs[mend] = ie;
+    mverts.resize(ie);
+    mverts.shrink_to_fit();
+
+    build_vertices(std::min(vertices_end(), base.vertices_end()));
+}
+
+}  // gecmi
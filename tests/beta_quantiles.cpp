@@ -0,0 +1,67 @@
+// Checks the approximation of the beta quantiles against the exact inverse
+// of the incomplete beta function
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <algorithm>
+#include <vector>
+
+#include <boost/math/special_functions/beta.hpp>
+
+#include "beta_quantiles.hpp"
+
+using namespace gecmi;
+
+// Max error of the approximation relative to the standard deviation
+constexpr double  SIGMA_ERROR_MAX = 3E-5;
+// Max error of the approximation relative to the deviation from the mean for prob
+// out of (DEVIATION_PROB_MIN, 1 - DEVIATION_PROB_MIN)
+constexpr double  DEVIATION_ERROR_MAX = 1E-5;
+constexpr double  DEVIATION_PROB_MIN = 0.3;
+
+int main()
+{
+    bool  res = true;
+    for(double prob: {0.99, 0.9, 0.7, 0.5, 0.3, 0.1, 0.01, 1E-3, 1E-4}) {
+        double  sigerr = 0;  // Max error relative to the standard deviation
+        double  deverr = 0;  // Max error relative to the deviation from the mean
+        bool  exact = true;  // The memoized quantiles are exact
+        for(int64_t total: {2 * BETA_APPROX_MIN, int64_t(1E4), int64_t(1E5), int64_t(1E6), int64_t(1E8), int64_t(1E10)}) {
+            beta_quantiles  quantiles(total, prob);
+            // Successes of the memoized and approximated quantiles
+            std::vector<int64_t>  successes = {0, 1, BETA_APPROX_MIN - 2, BETA_APPROX_MIN - 1
+                , total - BETA_APPROX_MIN, total - BETA_APPROX_MIN + 1, total - 1, total};
+            for(double share: {1E-6, 1E-4, 1E-3, 0.01, 0.1, 0.3, 0.5, 0.7, 0.9, 0.99, 0.999})
+                successes.push_back(BETA_APPROX_MIN - 1 + int64_t(share * (total - 2 * BETA_APPROX_MIN)));
+            for(auto success: successes)
+                quantiles.require(success);
+            quantiles.evaluate();
+
+            for(auto success: successes) {
+                const double  q = quantiles.quantile(success);
+                const double  a = success + 1;
+                const double  b = total - success;
+                const double  qex = success == total ? 1 : 1 - boost::math::ibeta_inv(b, a, prob);
+                if(a < BETA_APPROX_MIN || b < BETA_APPROX_MIN) {
+                    exact = exact && q == qex;
+                    continue;
+                }
+                const double  s = a + b;
+                const double  sig = std::sqrt(a * b / (s * s * (s + 1)));
+                const double  err = std::abs(q - qex);
+                sigerr = std::max(sigerr, err / sig);
+                deverr = std::max(deverr, err / std::abs(qex - a / s));
+            }
+        }
+        const bool  devcheck = prob <= DEVIATION_PROB_MIN || prob >= 1 - DEVIATION_PROB_MIN;
+        const bool  ok = exact && sigerr < SIGMA_ERROR_MAX && (!devcheck || deverr < DEVIATION_ERROR_MAX);
+        printf("prob %G: error / sigma: %.3G, error / deviation: %.3G, exact memoized: %d\n"
+            , prob, sigerr, deverr, exact);
+        if(!ok)
+            fprintf(stderr, "FAILED beta_quantiles at prob %G\n", prob);
+        res &= ok;
+    }
+    if(res)
+        printf("beta_quantiles: OK\n");
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,118 @@
+// Checks the exact evaluation of the hard partitions against the direct computation
+// of NMI from the contingency table and the detection of the hard partitions
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <map>
+#include <utility>
+#include <vector>
+
+#include "random_generator.hpp"
+#include "calculate_till_tolerance.hpp"
+
+using namespace gecmi;
+
+constexpr vmid_t  VERTICES = 20000;
+constexpr vmid_t  MODULES1 = 40;  // The number of clusters in the first partition
+constexpr vmid_t  MODULES2 = 32;  // The number of clusters in the second partition
+constexpr uint64_t  NOISE = 4;  // Each NOISE-th vertex of the second partition is reassigned randomly
+constexpr double  PRECISION = 1e-6;
+
+typedef std::vector<vmid_t>  clusters_t;  // Cluster (module) of each vertex
+
+// NMI_max and NMI_sqrt evaluated directly from the contingency table
+static void reference_nmi(const clusters_t& cls1, const clusters_t& cls2, double& nmi, double& nmi_sqrt)
+{
+    std::map<std::pair<vmid_t, vmid_t>, size_t>  cells;
+    std::map<vmid_t, size_t>  cnt1, cnt2;
+    for(size_t v = 0; v < cls1.size(); ++v) {
+        ++cells[{cls1[v], cls2[v]}];
+        ++cnt1[cls1[v]];
+        ++cnt2[cls2[v]];
+    }
+    const long double  total = cls1.size();
+    long double  h1 = 0, h2 = 0, mi = 0;
+    for(const auto& c: cnt1)
+        h1 -= c.second / total * std::log(c.second / total);
+    for(const auto& c: cnt2)
+        h2 -= c.second / total * std::log(c.second / total);
+    for(const auto& c: cells)
+        mi += c.second / total * std::log(c.second * total
+            / (cnt1[c.first.first] * cnt2[c.first.second]));
+    nmi = mi / std::max(h1, h2);
+    nmi_sqrt = mi / std::sqrt(h1 * h2);
+}
+
+// Index of the clusters
+static void build(vertex_module_index_t& vmi, const clusters_t& cls)
+{
+    vertex_module_index_t::memberships_t  mbs;
+    for(vmid_t v = 0; v < cls.size(); ++v)
+        mbs.emplace_back(v, cls[v]);
+    vmi.build(std::move(mbs));
+}
+
+static bool check(const char* name, bool res)
+{
+    if(res)
+        printf("%s: OK\n", name);
+    else fprintf(stderr, "FAILED %s\n", name);
+    return res;
+}
+
+int main()
+{
+    bool  res = true;
+
+    // Correlated hard partitions, the module ids start from 1
+    clusters_t  cls1(VERTICES), cls2(VERTICES);
+    uint64_t  rnd = 1;
+    for(vmid_t v = 0; v < VERTICES; ++v) {
+        cls1[v] = 1 + v * MODULES1 / VERTICES;
+        cls2[v] = 1 + (splitmix64(rnd) % NOISE ? v * MODULES2 / VERTICES : splitmix64(rnd) % MODULES2);
+    }
+    two_relations_t  tworel;
+    build(tworel.first, cls1);
+    build(tworel.second, cls2);
+
+    res &= check("hard_partitions()", hard_partitions(tworel));
+    double  nmi, nmi_sqrt;
+    reference_nmi(cls1, cls2, nmi, nmi_sqrt);
+    const calculated_info_t  cit = calculate_exact(tworel);
+    printf("NMI_max: %G (reference: %G), NMI_sqrt: %G (reference: %G)\n"
+        , cit.nmi, nmi, cit.nmi_sqrt, nmi_sqrt);
+    res &= check("calculate_exact()", std::abs(cit.nmi - nmi) < PRECISION
+        && std::abs(cit.nmi_sqrt - nmi_sqrt) < PRECISION && !cit.empirical_variance);
+
+    // The identical partitions
+    two_relations_t  same;
+    build(same.first, cls1);
+    build(same.second, cls1);
+    const calculated_info_t  cis = calculate_exact(same);
+    res &= check("calculate_exact() of the identical partitions"
+        , std::abs(cis.nmi - 1) < PRECISION && std::abs(cis.nmi_sqrt - 1) < PRECISION);
+
+    // The overlapping cover is not a hard partition
+    {
+        vertex_module_index_t::memberships_t  mbs;
+        for(vmid_t v = 0; v < VERTICES; ++v) {
+            mbs.emplace_back(v, cls1[v]);
+            if(v % 10 == 0)
+                mbs.emplace_back(v, 1 + cls1[v] % MODULES1);
+        }
+        two_relations_t  ovp;
+        ovp.first.build(std::move(mbs));
+        build(ovp.second, cls2);
+        res &= check("hard_partitions() of the overlapping cover", !hard_partitions(ovp));
+    }
+
+    // The node bases differ
+    {
+        two_relations_t  diff;
+        build(diff.first, cls1);
+        build(diff.second, clusters_t(cls2.begin(), cls2.end() - 1));
+        res &= check("hard_partitions() of the distinct node bases", !hard_partitions(diff));
+    }
+
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
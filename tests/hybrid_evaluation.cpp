@@ -0,0 +1,60 @@
+// Checks that the hybrid analytic/stochastic evaluation yields the same estimate
+// as the default (stochastic) evaluation on the overlapping covers
+#include <cstdio>
+#include <cstdlib>
+#include <cmath>
+#include <utility>
+
+#include "random_generator.hpp"
+#include "deep_complete_simulator.hpp"
+#include "calculate_till_tolerance.hpp"
+
+using namespace gecmi;
+
+constexpr vmid_t  VERTICES = 4000;
+constexpr vmid_t  MODULES1 = 40;  // The number of clusters in the first cover
+constexpr vmid_t  MODULES2 = 50;  // The number of clusters in the second cover
+constexpr double  RISK = 0.01;
+constexpr double  EPVAR = 0.001;
+
+// Cover of the vertices with the modules starting from 1
+// seed  - seed of the cover
+// modules  - the number of modules
+// noise  - each noise-th vertex is assigned to a random module, 0 means no noise
+// overlap  - each overlap-th vertex is assigned also to a random module
+// absent  - each absent-th vertex is omitted
+static void build(vertex_module_index_t& vmi, uint64_t seed, vmid_t modules, uint64_t noise
+    , uint64_t overlap, uint64_t absent)
+{
+    vertex_module_index_t::memberships_t  mbs;
+    for(vmid_t v = 0; v < VERTICES; ++v) {
+        if(splitmix64(seed) % absent == 0)
+            continue;
+        mbs.emplace_back(v, 1 + (noise && splitmix64(seed) % noise == 0
+            ? splitmix64(seed) % modules : v * modules / VERTICES));
+        if(splitmix64(seed) % overlap == 0)
+            mbs.emplace_back(v, 1 + splitmix64(seed) % modules);
+    }
+    vmi.build(std::move(mbs));
+}
+
+int main()
+{
+    // Note: the node bases differ, so the samples starting from the vertices absent
+    // in the other cover fail and are retried
+    two_relations_t  tworel;
+    build(tworel.first, 1, MODULES1, 0, 10, 3);
+    build(tworel.second, 2, MODULES2, 3, 5, 3);
+
+    deep_complete_simulator::seed(1);
+    const calculated_info_t  cid = calculate_till_tolerance(tworel, RISK, EPVAR);
+    const calculated_info_t  cih = calculate_till_tolerance(tworel, RISK, EPVAR, false, 0, 0, true);
+    printf("NMI_max: %G (default: %G), NMI_sqrt: %G (default: %G)\n"
+        , cih.nmi, cid.nmi, cih.nmi_sqrt, cid.nmi_sqrt);
+    const bool  res = std::abs(cih.nmi - cid.nmi) < EPVAR && std::abs(cih.nmi_sqrt - cid.nmi_sqrt) < EPVAR;
+    if(res)
+        printf("hybrid evaluation: OK\n");
+    else fprintf(stderr, "FAILED hybrid evaluation: the estimate differs from the default one by more than %G\n"
+        , EPVAR);
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}
@@ -0,0 +1,124 @@
+// Checks that the module set algebra and the sampling do not allocate memory
+// in the steady state, i.e. once the scratch buffers reached the required capacity
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "module_set.hpp"
+#include "player_automaton.hpp"
+#include "deep_complete_simulator.hpp"
+
+
+// The number of the performed allocations
+static size_t  allocations = 0;
+
+void* operator new(size_t size)
+{
+    ++allocations;
+    if(void* p = malloc(size ? size : 1))
+        return p;
+    throw std::bad_alloc();
+}
+
+void* operator new[](size_t size)  { return operator new(size); }
+void operator delete(void* p) noexcept  { free(p); }
+void operator delete[](void* p) noexcept  { free(p); }
+void operator delete(void* p, size_t) noexcept  { free(p); }
+void operator delete[](void* p, size_t) noexcept  { free(p); }
+
+using namespace gecmi;
+
+constexpr size_t  WARMUP_ROUNDS = 100000;
+constexpr size_t  ROUNDS = 100000;
+// The number of modules of the sets exceeding the inline capacity
+constexpr vmid_t  LARGE_SET = module_set_t::INLINE_CAPACITY * 3;
+
+// Report the failure if any allocations are performed by the rounds of op
+template <typename Op>
+static bool steady(const char* name, Op op)
+{
+    for(size_t i = 0; i < WARMUP_ROUNDS; ++i)
+        op(i);
+    const size_t  allocs = allocations;
+    for(size_t i = 0; i < ROUNDS; ++i)
+        op(i);
+    const size_t  num = allocations - allocs;
+    if(num)
+        fprintf(stderr, "FAILED %s: %lu allocations in %lu rounds\n", name, num, ROUNDS);
+    else printf("%s: OK\n", name);
+    return !num;
+}
+
+// Set of the modules [first, first + size)
+static module_set_t modules(vmid_t first, vmid_t size)
+{
+    module_set_t  ms;
+    for(vmid_t i = 0; i < size; ++i)
+        ms.push_back(first + i);
+    return ms;
+}
+
+int main()
+{
+    bool  res = true;
+
+    // Set operations and exchanges of the heap backed sets
+    {
+        const module_set_t  a = modules(0, LARGE_SET * 2);
+        const module_set_t  b = modules(LARGE_SET, LARGE_SET * 2);
+        module_set_t  x = a, y = b, out;
+        res &= steady("module_set_t operations", [&](size_t i) {
+            if(i % 2)
+                set_intersection(a, b, out);
+            else set_difference(a, b, out);
+            x.swap(out);
+            y = std::move(x);  // Heap over heap
+            x = a;
+            swap(x, y);
+        });
+    }
+
+    // Player automatons sharing the scratch buffer
+    {
+        const module_set_t  base = modules(0, LARGE_SET * 2);
+        const module_set_t  a = modules(0, LARGE_SET + 3);
+        const module_set_t  b = modules(LARGE_SET / 2, LARGE_SET);
+        module_set_t  rbuf1, rbuf2, tbuf;
+        res &= steady("player_automaton", [&](size_t i) {
+            player_automaton  pa1(base, rbuf1, tbuf), pa2(base, rbuf2, tbuf);
+            pa1.set_operation_kind(i % 2);
+            pa2.set_operation_kind(!(i % 2));
+            pa1.take_set(a);
+            pa2.take_set(b);
+            pa1.take_set(b);
+            pa2.take_set(a);
+        });
+    }
+
+    // Sampling of the heavily overlapping collections
+    {
+        constexpr vmid_t  vertices = 512;
+        two_relations_t  tworel;
+        vertex_module_index_t::memberships_t  mbs1, mbs2;
+        for(vmid_t v = 0; v < vertices; ++v)
+            for(vmid_t k = 0; k < LARGE_SET; ++k) {
+                mbs1.emplace_back(v, 1 + (v + k) % vertices);
+                mbs2.emplace_back(v, 1 + (v * 7 + k * 3) % vertices);
+            }
+        tworel.first.build(std::move(mbs1));
+        tworel.second.build(std::move(mbs2));
+        vertices_t  verts;
+        for(vmid_t v = 0; v < vertices; ++v)
+            verts.push_back(v);
+
+        deep_complete_simulator::seed(1);
+        deep_complete_simulator  dcs(tworel, verts);
+        simulation_result_t  sr;
+        res &= steady("deep_complete_simulator::get_sample()", [&](size_t i) {
+            dcs.reseed(i);
+            dcs.get_sample(sr, i % 2);
+        });
+    }
+
+    return res ? EXIT_SUCCESS : EXIT_FAILURE;
+}